@@ -0,0 +1,1953 @@
+#ifndef DBLSH_H
+#define DBLSH_H
+
+#include <iostream>
+#include <vector>
+#include <tuple>
+#include <cmath>
+#include <algorithm>
+#include <random>
+#include <set>
+#include <map>
+#include <limits>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include "R_star2.h"
+#include "hybrid_index.h"
+#include "planificador.h"
+#include "point_store.h"
+#include "pq.h"
+#include "kmeans.h"
+#include "thread_pool.h"
+#include "memory_tracking.h"
+#include "bounded_queue.h"
+#include "trace.h"
+
+using namespace std;
+
+// Familias de funciones hash (proyecciones aleatorias con la misma escala que
+// a·p con a ~ N(0, I), es decir h(p) ~ N(0, ||p||²) aproximadamente)
+//  GAUSSIANA:  a denso N(0,1) (paper), K·D multiplicaciones por tabla
+//  HADAMARD:   FJLT, H·D2·(H·D1·p)/√Dp y se toman K coordenadas, O(Dp log Dp)
+//  ACHLIOPTAS: a muy disperso √s·{+1, 0, -1} con s = √D, O(K·√D)
+enum class FamiliaHash { GAUSSIANA, HADAMARD, ACHLIOPTAS };
+
+inline const char* nombreFamilia(FamiliaHash f) {
+    switch(f) {
+        case FamiliaHash::HADAMARD: return "Hadamard (FJLT)";
+        case FamiliaHash::ACHLIOPTAS: return "Achlioptas disperso";
+        default: return "Gaussiana";
+    }
+}
+
+// Bytes por componente de un índice DB-LSH
+struct ReporteMemoria {
+    size_t almacen = 0;            // Puntos originales
+    size_t proyeccion = 0;         // Parámetros de las funciones hash (cubo L×K×D, signos, CSR)
+    size_t arboles = 0;            // Nodos de los L R*-trees
+    size_t pq = 0;                 // Códigos y centroides PQ
+    size_t construccion_pico = 0;  // Buffers transitorios de insertar() (pico)
+
+    size_t residente() const { return almacen + proyeccion + arboles + pq; }
+    size_t pico() const { return residente() + construccion_pico; }
+};
+
+inline void imprimirReporteMemoria(const ReporteMemoria& r, const string& titulo) {
+    auto mb = [](size_t b) { return b / (1024.0 * 1024.0); };
+    cout << titulo << endl;
+    cout << "  Almacén de puntos:      " << mb(r.almacen) << " MB" << endl;
+    cout << "  Proyecciones hash:      " << mb(r.proyeccion) << " MB" << endl;
+    cout << "  Nodos R*-tree:          " << mb(r.arboles) << " MB" << endl;
+    cout << "  PQ:                     " << mb(r.pq) << " MB" << endl;
+    cout << "  Residente total:        " << mb(r.residente()) << " MB" << endl;
+    cout << "  Transitorio (pico):     " << mb(r.construccion_pico) << " MB" << endl;
+}
+
+// Qué hacer si la memoria estimada supera el presupuesto configurado
+//  FALLAR:   lanzar excepción antes de construir nada
+//  DEGRADAR: pasar el almacén double a float y, si no basta, reducir L
+enum class PoliticaPresupuesto { FALLAR, DEGRADAR };
+
+// Orden físico de los puntos en el almacén
+//  ENTRADA: id interno = posición en el vector de entrada
+//  MORTON:  curva Z sobre las primeras coordenadas de G_1(p)
+//  KMEANS:  agrupados por cluster k-means (√n clusters) en el espacio de G_1
+// Los ids que devuelve la API son siempre los de entrada
+enum class OrdenAlmacen { ENTRADA, MORTON, KMEANS };
+
+inline const char* nombreOrden(OrdenAlmacen o) {
+    switch(o) {
+        case OrdenAlmacen::MORTON: return "Morton";
+        case OrdenAlmacen::KMEANS: return "k-means";
+        default: return "entrada";
+    }
+}
+
+// Contadores opcionales de una consulta: C_ANN_K(query, c, k, &estadisticas)
+struct EstadisticasConsulta {
+    size_t rondas = 0;        // Radios probados por C_ANN_K
+    size_t verificados = 0;   // Distancias exactas calculadas
+    size_t descartados = 0;   // Candidatos podados por distancia proyectada
+    double radio = 0.0;       // Radio r de la ronda con la que terminó C_ANN_K
+    size_t parciales = 0;     // Consultas cortadas por LimitesConsulta (respuesta parcial)
+    size_t filtrados = 0;     // Puntos de ventana rechazados por el filtro (no cuentan para T)
+    size_t plan_arbol = 0;    // Ventanas recorridas con el R*-tree
+    size_t plan_escaneo = 0;  // Ventanas resueltas con el escaneo plano (planificador)
+    size_t plan_fuerza_bruta = 0;   // Consultas respondidas por fuerza bruta (planificador)
+};
+
+// Presupuesto de una consulta anytime (0 = sin límite). Al agotarse, C_ANN_K
+// retorna los k mejores puntos verificados hasta ese momento
+struct LimitesConsulta {
+    double tiempo_ms = 0.0;      // Plazo de reloj desde que empieza la consulta
+    size_t max_distancias = 0;   // Distancias exactas como máximo
+
+    bool activo() const { return tiempo_ms > 0.0 || max_distancias > 0; }
+};
+
+// Predicado sobre los puntos de un índice: bitmap por id interno (el orden
+// físico depende del índice), construido con DBLSH::filtroEtiquetas o
+// DBLSH::filtroSi. Si viene de una sola etiqueta, C_ANN_K puede usar el
+// sub-índice de esa etiqueta en lugar de los árboles completos
+struct FiltroPuntos {
+    vector<uint64_t> bits;
+    size_t seleccionados = 0;
+    bool de_etiqueta = false;
+    int etiqueta = 0;
+
+    bool contiene(int id) const { return (bits[id >> 6] >> (id & 63)) & 1; }
+};
+
+// Diagnóstico estructural de un R*-tree y costo medio de sus ventanas w0·r
+struct DiagnosticoTabla {
+    EstadisticasArbol arbol;
+    double internos_por_ventana = 0.0;
+    double hojas_por_ventana = 0.0;
+    double puntos_por_ventana = 0.0;
+
+    // Fracción de hojas que toca una ventana: cerca de 1 el árbol es un scan
+    double fraccionHojas() const { return arbol.hojas() ? hojas_por_ventana / arbol.hojas() : 0.0; }
+};
+
+inline void imprimirDiagnosticoArboles(const vector<DiagnosticoTabla>& tablas, double ancho) {
+    cout << "Diagnóstico de R*-trees (ventanas de ancho " << ancho << "):" << endl;
+    for(size_t i = 0; i < tablas.size(); i++) {
+        const auto& t = tablas[i];
+        cout << "  Tabla " << i << ": altura " << t.arbol.altura() << ", " << t.arbol.nodos() << " nodos, llenado "
+             << t.arbol.llenadoMedio() * 100.0 << "%, por ventana " << t.internos_por_ventana << " internos + "
+             << t.hojas_por_ventana << " hojas (" << t.fraccionHojas() * 100.0 << "% de las hojas), "
+             << t.puntos_por_ventana << " puntos" << endl;
+        for(size_t nv = 0; nv < t.arbol.niveles.size(); nv++) {
+            const auto& n = t.arbol.niveles[nv];
+            cout << "    nivel " << nv << ": " << n.nodos << " nodos, llenado " << n.llenado(t.arbol.capacidad) * 100.0
+                 << "%, log10(vol) " << n.log10Volumen() << ", margen " << n.margen()
+                 << ", hermanos solapados " << n.fraccionSolapada() * 100.0 << "% (vol. " << n.solapamiento() * 100.0 << "%)";
+            if(n.padres) cout << ", espacio muerto " << n.espacioMuerto() * 100.0 << "%";
+            cout << endl;
+        }
+        if(t.fraccionHojas() > 0.5) cout << "    ⚠ las ventanas recorren más de la mitad de las hojas: el árbol degenera en scan" << endl;
+    }
+}
+
+// Cuantil p de la normal estándar (aproximación racional de Acklam, error < 1.2e-9)
+inline double cuantilNormal(double p) {
+    static const double a[] = {-3.969683028665376e+01, 2.209460984245205e+02, -2.759285104469687e+02,
+                               1.383577518672690e+02, -3.066479806614716e+01, 2.506628277459239e+00};
+    static const double b[] = {-5.447609879822406e+01, 1.615858368580409e+02, -1.556989798598866e+02,
+                               6.680131188771972e+01, -1.328068155288572e+01};
+    static const double c[] = {-7.784894002430293e-03, -3.223964580411365e-01, -2.400758277161838e+00,
+                               -2.549732539343734e+00, 4.374664141464968e+00, 2.938163982698783e+00};
+    static const double d[] = {7.784695709041462e-03, 3.224671290700398e-01, 2.445134137142996e+00,
+                               3.754408661907416e+00};
+    const double p_bajo = 0.02425;
+    if(p < p_bajo) {
+        double q = std::sqrt(-2 * std::log(p));
+        return (((((c[0]*q + c[1])*q + c[2])*q + c[3])*q + c[4])*q + c[5]) / ((((d[0]*q + d[1])*q + d[2])*q + d[3])*q + 1);
+    }
+    if(p > 1 - p_bajo) {
+        double q = std::sqrt(-2 * std::log(1 - p));
+        return -(((((c[0]*q + c[1])*q + c[2])*q + c[3])*q + c[4])*q + c[5]) / ((((d[0]*q + d[1])*q + d[2])*q + d[3])*q + 1);
+    }
+    double q = p - 0.5, r = q * q;
+    return (((((a[0]*r + a[1])*r + a[2])*r + a[3])*r + a[4])*r + a[5])*q / (((((b[0]*r + b[1])*r + b[2])*r + b[3])*r + b[4])*r + 1);
+}
+
+// Cuantil p de χ²_k (aproximación de Wilson–Hilferty)
+inline double cuantilChi2(size_t k, double p) {
+    double v = 2.0 / (9.0 * k);
+    double x = 1.0 - v + cuantilNormal(p) * std::sqrt(v);
+    return k * x * x * x;
+}
+
+// Clase DB-LSH (compartida por main_k.cpp y main_grafico.cpp)
+// K:  número de funciones hash = dimensión proyectada
+// DC: dimensión original fijada en compilación (p.ej. 128, 784, 960, 1024) para
+//     que proyección y distancias usen kernels de trip count fijo; 0 = D en ejecución
+// KT: coordenadas que indexa el árbol; 0 (o K) = R*-tree sobre las K, 0 < KT < K =
+//     índice híbrido (hybrid_index.h): R*-tree de KT dimensiones + filtro SoA del resto
+template <size_t K, size_t DC = 0, size_t KT = 0>
+class DBLSH {
+    public:
+        using Arbol = conditional_t<(KT == 0 || KT >= K), RStarTreeIndex<K>, IndiceHibrido<K, (KT == 0 || KT >= K) ? 1 : KT>>;
+
+    private:
+        int D;      // Dimensión original (ej: 2, 10, 128, 700)
+        int L;      // Número de tablas hash
+        double C;   // Constante de aproximación
+        double w0;  // Ancho de ventana base
+        double R_min; // Radio mínimo inicial
+        double t;
+        unsigned seed; // Semilla para reproducibilidad
+        bool verbose;  // Imprimir progreso de construcción
+        FamiliaHash familia;
+
+        vector<Arbol> indices;
+
+        // Caja de las proyecciones de cada tabla: con r ≥ radioCubre(ctx) toda
+        // ventana las contiene y agrandar r no agrega candidatos
+        vector<array<double, K>> minimos_proyeccion, maximos_proyeccion;
+
+        // Almacena los puntos originales (fila id = punto con ese id)
+        PointStore datos;
+        FormatoPuntos formato = FormatoPuntos::F64;
+
+        // Reordenamiento por localidad: los árboles y el almacén usan ids
+        // internos; externo_[interno] e interno_[externo] traducen en la API
+        // (vacíos = identidad)
+        OrdenAlmacen orden = OrdenAlmacen::ENTRADA;
+        vector<int> externo_, interno_;
+
+        // Prefiltro opcional: códigos PQ del almacén. Los candidatos de cada
+        // ventana se ordenan por distancia asimétrica y solo la fracción más
+        // prometedora pasa a la verificación exacta
+        ProductQuantizer pq;
+        size_t pq_M = 0;              // 0 = desactivado
+        double pq_fraccion = 1.0;     // Fracción de candidatos verificados
+
+        // Presupuesto de memoria (0 = sin límite)
+        size_t presupuesto = 0;
+        PoliticaPresupuesto politica = PoliticaPresupuesto::FALLAR;
+
+        // Ejecución en pipeline de RC_NN_K (nullptr = secuencial): hilos que
+        // recorren los árboles y entregan lotes de ids a la verificación
+        shared_ptr<ThreadPool> productores;
+        static constexpr size_t PIPELINE_LOTE = 64;       // ids por lote
+        static constexpr size_t PIPELINE_CAPACIDAD = 8;   // lotes en vuelo
+
+        // Prefetch durante la verificación: con los ids del lote ya conocidos,
+        // se pide la fila del candidato j+distancia_prefetch antes de calcular
+        // la distancia del candidato j (0 = desactivado)
+        size_t distancia_prefetch = 0;
+
+        // Fuera de memoria (insertarArchivo): el almacén queda en el archivo y
+        // solo las proyecciones (R*-trees) y una caché LRU de filas viven en RAM
+        bool en_disco = false;
+        size_t filas_cache_disco = 4096;
+        size_t hilos_disco = 4;
+        size_t bloque_disco = 64;   // Filas por lote de lectura en la verificación
+
+        // Orden por distancia proyectada: los candidatos de cada ventana se
+        // verifican de menor a mayor ||G(q) - G(o)||. Como ||G(q) - G(o)||² / ||q - o||²
+        // ~ χ²_K, un candidato con ||G(q) - G(o)||² > cuantil_chi2 · (c·r)² está a más de
+        // c·r con probabilidad ≥ confianza y se poda sin contar para T
+        bool orden_proyectado = false;
+        double cuantil_chi2 = 0.0;   // 0 = ordenar sin podar
+
+        // Radio inicial aprendido: radios_k[k-1] = distancias exactas (ordenadas)
+        // de una muestra de puntos indexados a su k-ésimo vecino. C_ANN_K arranca
+        // en el cuantil_radio de esa distribución y recorre los radios por galope
+        // (×factor_galope) y bisección en lugar de r *= c desde R_min
+        size_t muestra_radios = 0;   // 0 = desactivado
+        size_t k_max_radios = 100;
+        double cuantil_radio = 0.1;
+        double factor_galope = 2.0;
+        vector<vector<double>> radios_k;
+
+        // Planificador por costo: por tabla, histogramas de las proyecciones
+        // (selectividad de las ventanas), hojas del árbol y la proyección
+        // plana que recorre el plan ESCANEO. Vacíos = siempre el árbol
+        bool planificador = false;
+        CostesPlan costes_plan;
+        vector<HistogramaProyecciones<K>> histogramas;
+        vector<ProyeccionPlana<K>> planos;
+        vector<size_t> hojas_tabla;
+        static constexpr size_t DIMS_ARBOL = (KT == 0 || KT >= K) ? K : KT;
+
+        // Atributos: etiquetas_[id interno] (vacío = sin etiquetas). Cada
+        // etiqueta con a lo sumo fraccion_subindice·n puntos tiene además sus
+        // propias L tablas (mismas funciones hash, solo sus puntos) para los
+        // filtros muy selectivos, donde las ventanas completas son casi todo rechazo
+        vector<int> etiquetas_entrada;   // Del próximo insertar(), en orden de entrada
+        vector<int> etiquetas_;
+        double fraccion_subindice = 0.0;
+        map<int, vector<Arbol>> subindices;
+
+        // Matriz de proyección (GAUSSIANA) de cada tabla: K filas × D columnas,
+        // cada fila rellena con ceros hasta un múltiplo de CARRILES y alineada a
+        // 64 bytes (vector de bloques alignas: new alineado de C++17)
+        struct alignas(kernels::ALINEACION) BloqueAlineado { double v[kernels::CARRILES]; };
+        vector<vector<BloqueAlineado>> a;
+        size_t bloques_fila = 0;
+
+        // a_i[j] = coeficientes de la función hash j de la tabla i
+        const double* filaProyeccion(int tabla, size_t j) const {
+            return reinterpret_cast<const double*>(a[tabla].data() + j * bloques_fila);
+        }
+
+        // HADAMARD: por tabla, signos de D1 y D2 (Dp = potencia de 2 ≥ D)
+        // y las K coordenadas de la transformada que forman G(p)
+        size_t Dp = 0;
+        vector<vector<double>> signos1, signos2;
+        vector<array<size_t, K>> filas_hadamard;
+
+        // ACHLIOPTAS: por tabla, matriz K×D dispersa en formato CSR
+        struct ProyeccionDispersa {
+            vector<size_t> inicio;   // K+1 offsets
+            vector<int> columna;
+            vector<double> valor;    // ±√s
+        };
+        vector<ProyeccionDispersa> dispersas;
+
+        // Generar funciones hash aleatorias
+        void generarFuncionesHash() {
+            TRACE_SCOPE("generarFuncionesHash");
+            mt19937 gen(seed);
+            if(familia == FamiliaHash::HADAMARD) {
+                generarHadamard(gen);
+                return;
+            }
+            if(familia == FamiliaHash::ACHLIOPTAS) {
+                generarAchlioptas(gen);
+                return;
+            }
+
+            a.resize(L);
+            bloques_fila = (static_cast<size_t>(D) + kernels::CARRILES - 1) / kernels::CARRILES;
+            normal_distribution<double> dist(0.0, 1.0);
+            for(int i = 0; i < L; i++) {
+                a[i].assign(K * bloques_fila, BloqueAlineado{});
+
+                for(size_t j = 0; j < K; j++) {
+                    double* fila = reinterpret_cast<double*>(a[i].data() + j * bloques_fila);
+
+                    // Generar vector aleatorio N(0,1)
+                    for(int k = 0; k < D; k++) {
+                        fila[k] = dist(gen);
+                    }
+                }
+            }
+        }
+
+        void generarHadamard(mt19937& gen) {
+            Dp = 1;
+            while(Dp < static_cast<size_t>(D)) Dp <<= 1;
+            if(K > Dp) throw runtime_error("HADAMARD requiere K <= " + to_string(Dp));
+
+            bernoulli_distribution moneda(0.5);
+            signos1.assign(L, vector<double>(Dp));
+            signos2.assign(L, vector<double>(Dp));
+            filas_hadamard.resize(L);
+            vector<size_t> perm(Dp);
+            for(int i = 0; i < L; i++) {
+                for(size_t d = 0; d < Dp; d++) {
+                    signos1[i][d] = moneda(gen) ? 1.0 : -1.0;
+                    signos2[i][d] = moneda(gen) ? 1.0 : -1.0;
+                }
+                // K coordenadas distintas de la transformada
+                for(size_t d = 0; d < Dp; d++) perm[d] = d;
+                shuffle(perm.begin(), perm.end(), gen);
+                for(size_t j = 0; j < K; j++) filas_hadamard[i][j] = perm[j];
+            }
+        }
+
+        void generarAchlioptas(mt19937& gen) {
+            // Very sparse random projections: P(±√s) = 1/(2s), P(0) = 1 - 1/s
+            double s_disp = max(1.0, sqrt(static_cast<double>(D)));
+            double escala = sqrt(s_disp);
+            uniform_real_distribution<double> u(0.0, 1.0);
+            dispersas.resize(L);
+            for(int i = 0; i < L; i++) {
+                ProyeccionDispersa& p = dispersas[i];
+                p.inicio.assign(1, 0);
+                for(size_t j = 0; j < K; j++) {
+                    for(int d = 0; d < D; d++) {
+                        double x = u(gen) * s_disp;
+                        if(x < 0.5) { p.columna.push_back(d); p.valor.push_back(escala); }
+                        else if(x < 1.0) { p.columna.push_back(d); p.valor.push_back(-escala); }
+                    }
+                    p.inicio.push_back(p.columna.size());
+                }
+            }
+        }
+
+        // Proyectar punto N-dimensional → K-dimensional. El tamaño de `punto`
+        // se valida en la API (insertar, validarQuery), no en cada proyección
+        array<double, K> funcionHash(const vector<double>& punto, int tabla) const {
+            return funcionHash(punto.data(), tabla);
+        }
+
+        array<double, K> funcionHash(const double* punto, int tabla) const {
+            array<double, K> hash_result;
+
+            if(familia == FamiliaHash::HADAMARD) {
+                // y = H·D2·(H·D1·p)/√Dp: la primera rotación (ortonormal) reparte
+                // la masa de p entre coordenadas; la segunda da varianza ||p||²
+                vector<double> v(Dp, 0.0);
+                for(int j = 0; j < D; j++) v[j] = punto[j] * signos1[tabla][j];
+                kernels::fwht(v.data(), Dp);
+                double norm = 1.0 / sqrt(static_cast<double>(Dp));
+                for(size_t j = 0; j < Dp; j++) v[j] *= norm * signos2[tabla][j];
+                kernels::fwht(v.data(), Dp);
+                for(size_t i = 0; i < K; i++) hash_result[i] = v[filas_hadamard[tabla][i]];
+                return hash_result;
+            }
+
+            if(familia == FamiliaHash::ACHLIOPTAS) {
+                const ProyeccionDispersa& p = dispersas[tabla];
+                for(size_t i = 0; i < K; i++) {
+                    double sum = 0.0;
+                    for(size_t e = p.inicio[i]; e < p.inicio[i + 1]; e++) {
+                        sum += p.valor[e] * punto[p.columna[e]];
+                    }
+                    hash_result[i] = sum;
+                }
+                return hash_result;
+            }
+
+            // h_i(p) = a[i] · p (producto punto) para cada función hash
+            for(size_t i = 0; i < K; i++) {
+                hash_result[i] = kernels::dot_f64<DC>(filaProyeccion(tabla, i), punto, D);
+            }
+
+            return hash_result;
+        }
+
+        // Límite de ||G(q) - G(o)||² para verificar a radio c·r
+        double limiteProyeccion2(double radio) const {
+            return cuantil_chi2 > 0.0 ? cuantil_chi2 * radio * radio : numeric_limits<double>::infinity();
+        }
+
+        // Candidatos nuevos de una ventana ordenados por distancia proyectada;
+        // los podados no se marcan como visitados (otra tabla puede acercarlos)
+        // (id_de(res) y proyectada(res) = ||G(q) - G(o)||² de cada resultado).
+        // Con marcar = false tampoco los demás: los marca prefiltrarPQ
+        template <typename Ventana, typename Id, typename Proyectada>
+        void ordenarPorProyeccion(const Ventana& resultados, Id id_de, Proyectada proyectada, double radio, bool marcar,
+                                  set<int>& ids_visitados, vector<int>& lote, EstadisticasConsulta* estadisticas) const {
+            const double limite2 = limiteProyeccion2(radio);
+            vector<pair<double, int>> orden_lote;
+            orden_lote.reserve(resultados.size());
+            for(const auto& res : resultados) {
+                int id = id_de(res);
+                if(ids_visitados.count(id)) continue;
+                double d2 = proyectada(res);
+                if(d2 > limite2) {
+                    if(estadisticas) estadisticas->descartados++;
+                    continue;
+                }
+                if(marcar) ids_visitados.insert(id);
+                orden_lote.push_back({d2, id});
+            }
+            sort(orden_lote.begin(), orden_lote.end());
+            for(const auto& [d2, id] : orden_lote) lote.push_back(id);
+        }
+
+        // k-NN exactos (fuerza bruta) de muestra_radios puntos del almacén,
+        // excluyendo al propio punto, agrupados por k
+        void aprenderRadios() {
+            radios_k.clear();
+            const size_t n = datos.size();
+            if(muestra_radios == 0 || n < 2) return;
+            TRACE_SCOPE("aprender radios");
+            const size_t m = min(muestra_radios, n);
+            const size_t k_max = min(k_max_radios, n - 1);
+            vector<size_t> ids(n);
+            for(size_t j = 0; j < n; j++) ids[j] = j;
+            mt19937 gen(seed);
+            shuffle(ids.begin(), ids.end(), gen);
+
+            // Una sola pasada por el almacén (secuencial también en disco): cada
+            // fila actualiza el max-heap de las k_max menores distancias² de cada
+            // punto de la muestra
+            vector<vector<double>> puntos(m);
+            vector<PointStore::Consulta> consultas(m);
+            vector<vector<double>> cercanos(m);
+            for(size_t s = 0; s < m; s++) {
+                puntos[s] = datos.fila(ids[s]);
+                consultas[s] = datos.preparar(puntos[s]);
+                cercanos[s].reserve(k_max);
+            }
+            datos.recorrer([&](size_t j, const char* fila) {
+                for(size_t s = 0; s < m; s++) {
+                    if(j == ids[s]) continue;
+                    double d2 = datos.distancia2Fila<DC>(consultas[s], fila);
+                    vector<double>& h = cercanos[s];
+                    if(h.size() < k_max) {
+                        h.push_back(d2);
+                        push_heap(h.begin(), h.end());
+                    } else if(d2 < h.front()) {
+                        pop_heap(h.begin(), h.end());
+                        h.back() = d2;
+                        push_heap(h.begin(), h.end());
+                    }
+                }
+            });
+            radios_k.assign(k_max, vector<double>(m));
+            for(size_t s = 0; s < m; s++) {
+                sort_heap(cercanos[s].begin(), cercanos[s].end());
+                for(size_t k = 0; k < k_max; k++) radios_k[k][s] = sqrt(cercanos[s][k]);
+            }
+            for(auto& dist : radios_k) sort(dist.begin(), dist.end());
+            if(verbose) {
+                cout << "Radio aprendido (" << m << " puntos): r_inicial(k=1) = " << radioInicial(1)
+                     << ", r_inicial(k=" << k_max << ") = " << radioInicial(static_cast<int>(k_max)) << endl;
+            }
+        }
+
+        int externo(int id) const { return externo_.empty() ? id : externo_[id]; }
+        int interno(int id) const { return interno_.empty() ? id : interno_[id]; }
+
+        // Curva Z: las primeras coordenadas de G_1(p) se cuantizan a 60/dims
+        // bits y se intercalan; puntos cercanos en la proyección quedan cerca en el orden
+        template <typename Fila>
+        vector<int> ordenMorton(size_t n, Fila fila) const {
+            const size_t dims = min<size_t>(K, 6);
+            const size_t bits = 60 / dims;
+            vector<array<double, K>> h(n);
+            for(size_t j = 0; j < n; j++) h[j] = funcionHash(fila(j), 0);
+
+            vector<double> lo(dims, numeric_limits<double>::max()), hi(dims, numeric_limits<double>::lowest());
+            for(const auto& p : h) {
+                for(size_t d = 0; d < dims; d++) { lo[d] = min(lo[d], p[d]); hi[d] = max(hi[d], p[d]); }
+            }
+            const double celdas = static_cast<double>((uint64_t(1) << bits) - 1);
+            vector<pair<uint64_t, int>> codigos(n);
+            for(size_t j = 0; j < n; j++) {
+                uint64_t codigo = 0;
+                for(size_t d = 0; d < dims; d++) {
+                    double rango = hi[d] > lo[d] ? hi[d] - lo[d] : 1.0;
+                    uint64_t celda = static_cast<uint64_t>((h[j][d] - lo[d]) / rango * celdas);
+                    for(size_t b = 0; b < bits; b++) codigo |= ((celda >> b) & 1) << (b * dims + d);
+                }
+                codigos[j] = {codigo, static_cast<int>(j)};
+            }
+            sort(codigos.begin(), codigos.end());
+            vector<int> resultado(n);
+            for(size_t j = 0; j < n; j++) resultado[j] = codigos[j].second;
+            return resultado;
+        }
+
+        // k-means (entrenado sobre una muestra) en el espacio de G_1 y orden por cluster
+        template <typename Fila>
+        vector<int> ordenKMeans(size_t n, Fila fila) const {
+            vector<float> h(n * K);
+            for(size_t j = 0; j < n; j++) {
+                array<double, K> p = funcionHash(fila(j), 0);
+                for(size_t d = 0; d < K; d++) h[j * K + d] = static_cast<float>(p[d]);
+            }
+            mt19937 gen(seed);
+            const size_t clusters = max<size_t>(1, static_cast<size_t>(std::sqrt(static_cast<double>(n))));
+            const size_t n_muestra = min(n, max<size_t>(4096, clusters * 16));
+            vector<size_t> muestra(n);
+            for(size_t j = 0; j < n; j++) muestra[j] = j;
+            shuffle(muestra.begin(), muestra.end(), gen);
+            vector<float> entrenamiento(n_muestra * K);
+            for(size_t j = 0; j < n_muestra; j++) {
+                copy(&h[muestra[j] * K], &h[muestra[j] * K] + K, &entrenamiento[j * K]);
+            }
+            vector<float> centroides = kmeansLloyd(entrenamiento, n_muestra, K, clusters, 6, gen);
+
+            vector<pair<int, int>> asignacion(n);  // {cluster, id}
+            for(size_t j = 0; j < n; j++) {
+                float mejor = numeric_limits<float>::max();
+                int mejor_c = 0;
+                for(size_t c = 0; c < clusters; c++) {
+                    float d2 = 0.0f;
+                    for(size_t d = 0; d < K; d++) {
+                        float diff = h[j * K + d] - centroides[c * K + d];
+                        d2 += diff * diff;
+                    }
+                    if(d2 < mejor) { mejor = d2; mejor_c = static_cast<int>(c); }
+                }
+                asignacion[j] = {mejor_c, static_cast<int>(j)};
+            }
+            sort(asignacion.begin(), asignacion.end());
+            vector<int> resultado(n);
+            for(size_t j = 0; j < n; j++) resultado[j] = asignacion[j].second;
+            return resultado;
+        }
+
+        // Quitar las últimas tablas (las funciones hash de las restantes no cambian)
+        void reducirTablas(int L_nuevo) {
+            L = L_nuevo;
+            indices.resize(L);
+            if(!a.empty()) a.resize(L);
+            if(!signos1.empty()) { signos1.resize(L); signos2.resize(L); filas_hadamard.resize(L); }
+            if(!dispersas.empty()) dispersas.resize(L);
+        }
+
+        // Comprobar la estimación de memoria contra el presupuesto antes de
+        // construir; según la política, fallar o degradar la configuración
+        void aplicarPresupuesto(size_t n) {
+            if(presupuesto == 0) return;
+            ReporteMemoria est = estimarMemoria(n);
+            if(est.pico() <= presupuesto) return;
+
+            auto mb = [](size_t b) { return to_string(b / (1024 * 1024)) + " MB"; };
+            if(politica == PoliticaPresupuesto::FALLAR) {
+                throw runtime_error("Memoria estimada " + mb(est.pico()) + " supera el presupuesto de "
+                                    + mb(presupuesto) + " (almacén " + mb(est.almacen) + ", árboles "
+                                    + mb(est.arboles) + ", transitorio " + mb(est.construccion_pico) + ")");
+            }
+
+            if(formato == FormatoPuntos::F64 && !en_disco) {
+                formato = FormatoPuntos::F32;
+                est = estimarMemoria(n);
+                if(verbose) cout << "Presupuesto: almacén degradado a float (" << mb(est.pico()) << ")" << endl;
+            }
+            while(est.pico() > presupuesto && L > 1) {
+                reducirTablas(L - 1);
+                est = estimarMemoria(n);
+            }
+            if(verbose) cout << "Presupuesto: " << L << " tablas hash (" << mb(est.pico()) << ")" << endl;
+            if(est.pico() > presupuesto) {
+                throw runtime_error("Memoria estimada " + mb(est.pico()) + " supera el presupuesto de "
+                                    + mb(presupuesto) + " incluso con L = 1");
+            }
+        }
+
+        // Estado de una consulta con presupuesto. El hilo de la consulta cuenta
+        // distancias y conserva los k mejores verificados (la respuesta parcial);
+        // el productor del pipeline solo consulta el reloj. El reloj se lee cada
+        // PASO_RELOJ distancias o puntos de ventana y al empezar cada ronda
+        struct Plazo {
+            static constexpr size_t PASO_RELOJ = 32;
+            bool con_tiempo;
+            chrono::steady_clock::time_point fin;
+            size_t max_distancias;
+            size_t distancias = 0;
+            atomic<bool> agotado{false};
+            size_t k;
+            vector<pair<double, int>> mejores;   // Max-heap (distancia, id interno)
+
+            Plazo(const LimitesConsulta& limites, int k)
+                : con_tiempo(limites.tiempo_ms > 0.0),
+                  fin(chrono::steady_clock::now() + chrono::duration_cast<chrono::steady_clock::duration>(
+                          chrono::duration<double, milli>(limites.tiempo_ms))),
+                  max_distancias(limites.max_distancias), k(static_cast<size_t>(max(k, 0))) {
+                mejores.reserve(this->k);
+            }
+
+            bool vencido() {
+                if(agotado.load(memory_order_relaxed)) return true;
+                if(con_tiempo && chrono::steady_clock::now() >= fin) agotado.store(true, memory_order_relaxed);
+                return agotado.load(memory_order_relaxed);
+            }
+
+            // Registrar una distancia exacta; true si el presupuesto se agotó
+            bool registrar(int id, double dist) {
+                distancias++;
+                if(mejores.size() < k) {
+                    mejores.push_back({dist, id});
+                    push_heap(mejores.begin(), mejores.end());
+                } else if(k > 0 && dist < mejores.front().first) {
+                    pop_heap(mejores.begin(), mejores.end());
+                    mejores.back() = {dist, id};
+                    push_heap(mejores.begin(), mejores.end());
+                }
+                if(max_distancias && distancias >= max_distancias) agotado.store(true, memory_order_relaxed);
+                if(distancias % PASO_RELOJ == 0) return vencido();
+                return agotado.load(memory_order_relaxed);
+            }
+        };
+
+        // Datos de una query que no dependen del radio: se calculan una sola vez
+        // por consulta y se reutilizan en todas las rondas de C_ANN_K
+        struct ContextoConsulta {
+            const vector<double>* query = nullptr;
+            PointStore::Consulta consulta;     // Query preparada para el almacén
+            vector<float> tabla_pq;            // Tabla ADC (si PQ activo)
+            vector<array<double, K>> hashes;   // G_i(q) para cada tabla i
+            EstadisticasConsulta* estadisticas = nullptr;
+            Plazo* plazo = nullptr;            // Solo en consultas con LimitesConsulta
+            const FiltroPuntos* filtro = nullptr;
+            const vector<Arbol>* arboles = nullptr;   // Sub-índice (nullptr = indices)
+            double selectividad = 1.0;         // Fracción de puntos que admite el filtro
+        };
+
+        // Bitmap con los ids internos j que cumplen pred(j)
+        template <typename Pred>
+        FiltroPuntos filtroInternos(Pred pred) const {
+            FiltroPuntos f;
+            f.bits.assign((datos.size() + 63) / 64, 0);
+            for(size_t j = 0; j < datos.size(); j++) {
+                if(!pred(j)) continue;
+                f.bits[j >> 6] |= uint64_t(1) << (j & 63);
+                f.seleccionados++;
+            }
+            return f;
+        }
+
+        // Con sub-índice para la etiqueta del filtro se recorren sus árboles,
+        // donde todos los puntos lo cumplen; si no, el bitmap se aplica a cada
+        // punto que sale de las ventanas
+        void aplicarFiltro(ContextoConsulta& ctx, const FiltroPuntos& filtro) const {
+            if(filtro.bits.size() != (datos.size() + 63) / 64) {
+                throw runtime_error("Filtro construido para un índice de otro tamaño");
+            }
+            ctx.selectividad = static_cast<double>(filtro.seleccionados) / datos.size();
+            auto sub = filtro.de_etiqueta ? subindices.find(filtro.etiqueta) : subindices.end();
+            if(sub != subindices.end()) ctx.arboles = &sub->second;
+            else ctx.filtro = &filtro;
+        }
+
+        // Respuesta de una consulta cortada por su plazo: los k mejores verificados
+        vector<tuple<int, vector<double>, double>> respuestaParcial(const ContextoConsulta& ctx) const {
+            if(ctx.estadisticas) ctx.estadisticas->parciales++;
+            vector<pair<double, int>> mejores = ctx.plazo->mejores;
+            sort(mejores.begin(), mejores.end());
+            vector<tuple<int, vector<double>, double>> resultado;
+            resultado.reserve(mejores.size());
+            for(const auto& [dist, id] : mejores) resultado.push_back({externo(id), datos.fila(id), dist});
+            return resultado;
+        }
+
+        // Plan de una ronda de RC_NN_K
+        struct PlanRonda {
+            vector<PlanVentana> tablas;   // Vacío = árbol en todas
+            bool fuerza_bruta = false;
+            double coste = 0.0;           // ns estimados de la ronda (con el plan)
+        };
+
+        // Plan de la ronda de radio r: cada tabla usa el árbol o el escaneo según
+        // el costo estimado de su ventana. La consulta pasa a fuerza bruta cuando
+        // recorrer el almacén cuesta menos que lo ya gastado en rondas anteriores
+        // (gastado, ns estimados) más esta ronda: L ventanas y las distancias de
+        // sus puntos (a lo sumo T). Como en el alquiler de esquíes, el total
+        // queda en ≤ 2× el de la mejor alternativa aunque no se sepa cuántas
+        // rondas faltan. Sin planificador o con sub-índice, árbol en todas; la
+        // fuerza bruta requiere almacén en memoria y no tener plazo
+        PlanRonda planificar(const ContextoConsulta& ctx, double r, int T, double gastado = 0.0) const {
+            PlanRonda plan;
+            if(histogramas.empty() || ctx.arboles) return plan;
+            const size_t n = datos.size();
+            const double threshold = w0 * r / 2.0;
+            double coste_ventanas = 0.0, puntos = 0.0;
+            plan.tablas.resize(L);
+            for(int i = 0; i < L; i++) {
+                array<double, K> mins, maxs;
+                for(size_t j = 0; j < K; j++) {
+                    mins[j] = ctx.hashes[i][j] - threshold;
+                    maxs[j] = ctx.hashes[i][j] + threshold;
+                }
+                EstimacionVentana e = estimarVentana(histogramas[i], n, hojas_tabla[i], DIMS_ARBOL, mins, maxs, costes_plan);
+                plan.tablas[i] = e.plan();
+                coste_ventanas += e.coste();
+                puntos += e.puntos;
+            }
+            const double coste_distancia = D * (costes_plan.coordenada_distancia
+                                              + costes_plan.byte_distancia * bytesPorCoordenada(datos.formato()));
+            const double verificados = min({puntos * ctx.selectividad, static_cast<double>(T), static_cast<double>(n)});
+            const double coste_bruta = n * ctx.selectividad * coste_distancia;
+            plan.coste = coste_ventanas + verificados * coste_distancia + L * K * costes_plan.coordenada_plan;
+            plan.fuerza_bruta = !datos.enDisco() && !ctx.plazo && coste_bruta < gastado + plan.coste;
+            return plan;
+        }
+
+        // Respuesta exacta (plan FUERZA_BRUTA): los k puntos admitidos más
+        // cercanos de todo el almacén
+        vector<tuple<int, vector<double>, double>> fuerzaBruta(const ContextoConsulta& ctx, int k) const {
+            TRACE_SCOPE("fuerza bruta");
+            if(ctx.estadisticas) ctx.estadisticas->plan_fuerza_bruta++;
+            vector<pair<double, int>> mejores;   // Max-heap (distancia, id interno)
+            size_t verificados = 0;
+            datos.recorrer([&](size_t j, const char* fila) {
+                int id = static_cast<int>(j);
+                if(ctx.filtro && !ctx.filtro->contiene(id)) return;
+                verificados++;
+                double dist = sqrt(datos.distancia2Fila<DC>(ctx.consulta, fila));
+                if(mejores.size() < static_cast<size_t>(k)) {
+                    mejores.push_back({dist, id});
+                    push_heap(mejores.begin(), mejores.end());
+                } else if(k > 0 && dist < mejores.front().first) {
+                    pop_heap(mejores.begin(), mejores.end());
+                    mejores.back() = {dist, id};
+                    push_heap(mejores.begin(), mejores.end());
+                }
+            });
+            if(ctx.estadisticas) ctx.estadisticas->verificados += verificados;
+            sort(mejores.begin(), mejores.end());
+            vector<tuple<int, vector<double>, double>> resultado;
+            resultado.reserve(mejores.size());
+            for(const auto& [dist, id] : mejores) resultado.push_back({externo(id), datos.fila(id), dist});
+            return resultado;
+        }
+
+        void validarQuery(const vector<double>& query) const {
+            if(static_cast<int>(query.size()) != D) {
+                throw runtime_error("Query debe tener " + to_string(D) + " dimensiones");
+            }
+        }
+
+        ContextoConsulta prepararConsulta(const vector<double>& query) const {
+            ContextoConsulta ctx;
+            ctx.query = &query;
+            ctx.consulta = datos.preparar(query);
+            if(pq.activo()) ctx.tabla_pq = pq.tablaDistancias(query.data());
+            ctx.hashes.resize(L);
+            for(int i = 0; i < L; i++) ctx.hashes[i] = funcionHash(query, i);
+            return ctx;
+        }
+
+        // Proyección por lotes: con la familia gaussiana cada fila a[i][j] se
+        // recorre una vez para todo el lote (reutilización en caché) en lugar
+        // de una vez por query
+        vector<ContextoConsulta> prepararLote(const vector<vector<double>>& queries) const {
+            vector<ContextoConsulta> ctxs(queries.size());
+            for(size_t b = 0; b < queries.size(); b++) {
+                validarQuery(queries[b]);
+                ctxs[b].query = &queries[b];
+                ctxs[b].consulta = datos.preparar(queries[b]);
+                if(pq.activo()) ctxs[b].tabla_pq = pq.tablaDistancias(queries[b].data());
+                ctxs[b].hashes.resize(L);
+            }
+            for(int i = 0; i < L; i++) {
+                if(familia != FamiliaHash::GAUSSIANA) {
+                    for(size_t b = 0; b < queries.size(); b++) ctxs[b].hashes[i] = funcionHash(queries[b], i);
+                    continue;
+                }
+                for(size_t j = 0; j < K; j++) {
+                    const double* fila = filaProyeccion(i, j);
+                    for(size_t b = 0; b < queries.size(); b++) {
+                        ctxs[b].hashes[i][j] = kernels::dot_f64<DC>(fila, queries[b].data(), D);
+                    }
+                }
+            }
+            return ctxs;
+        }
+
+        // Distancias exactas a ids en orden: visitar(id, dist) retorna true para
+        // terminar (y verificarIds retorna true). En memoria, con prefetch de la
+        // fila j + distancia_prefetch; en disco las filas se piden por bloques de
+        // bloque_disco (un lote de preads agrupados), así que se leen a lo sumo
+        // bloque_disco filas de más al terminar antes de tiempo
+        template <typename F>
+        bool verificarIds(const PointStore::Consulta& consulta, const vector<int>& ids, F visitar) const {
+            if(datos.enDisco()) {
+                vector<char> filas;
+                const size_t bytes_fila = datos.bytesFila();
+                for(size_t inicio = 0; inicio < ids.size(); inicio += bloque_disco) {
+                    size_t m = min(bloque_disco, ids.size() - inicio);
+                    datos.leerFilas(ids.data() + inicio, m, filas);
+                    for(size_t j = 0; j < m; j++) {
+                        double dist = sqrt(datos.distancia2Fila<DC>(consulta, &filas[j * bytes_fila]));
+                        if(visitar(ids[inicio + j], dist)) return true;
+                    }
+                }
+                return false;
+            }
+            for(size_t j = 0; j < min(distancia_prefetch, ids.size()); j++) datos.prefetch(ids[j]);
+            for(size_t j = 0; j < ids.size(); j++) {
+                if(distancia_prefetch > 0 && j + distancia_prefetch < ids.size()) {
+                    datos.prefetch(ids[j + distancia_prefetch]);
+                }
+                if(visitar(ids[j], datos.distancia<DC>(consulta, ids[j]))) return true;
+            }
+            return false;
+        }
+
+        // Ordenar el lote por distancia PQ y quedarse con la fracción más
+        // prometedora (al menos k), que es la única que paga la distancia exacta.
+        // Solo esos se marcan como visitados: un id descartado aquí puede volver
+        // en otra tabla o radio y pasar el corte en ese lote
+        void prefiltrarPQ(vector<int>& lote, const vector<float>& tabla_pq, int k, set<int>& ids_visitados) const {
+            size_t n_verificar = static_cast<size_t>(ceil(pq_fraccion * lote.size()));
+            n_verificar = min(lote.size(), max(n_verificar, static_cast<size_t>(k)));
+
+            vector<pair<float, int>> puntuados;
+            puntuados.reserve(lote.size());
+            for(int id : lote) puntuados.push_back({pq.distanciaAsimetrica(tabla_pq, id), id});
+            partial_sort(puntuados.begin(), puntuados.begin() + n_verificar, puntuados.end());
+
+            lote.resize(n_verificar);
+            for(size_t j = 0; j < n_verificar; j++) {
+                lote[j] = puntuados[j].second;
+                ids_visitados.insert(lote[j]);
+            }
+        }
+
+    public:
+        // Ground Truth: Encontrar k vecinos más cercanos reales (fuerza bruta)
+        // (solo entre los puntos del filtro, si se pasa uno)
+        vector<pair<int, double>> encontrarKVecinosReales(const vector<double>& query, int k,
+                                                          const FiltroPuntos* filtro = nullptr) const {
+            validarQuery(query);
+            // Calcular distancias a todos los puntos
+            PointStore::Consulta consulta = datos.preparar(query);
+            vector<pair<double, int>> distancias;
+            distancias.reserve(filtro ? filtro->seleccionados : datos.size());
+
+            datos.recorrer([&](size_t i, const char* fila) {
+                if(filtro && !filtro->contiene(static_cast<int>(i))) return;
+                double dist = sqrt(datos.distancia2Fila<DC>(consulta, fila));
+                distancias.push_back({dist, externo(static_cast<int>(i))});
+            });
+
+            // Ordenar por distancia (parcial sort hasta k)
+            partial_sort(distancias.begin(),
+                        distancias.begin() + min(k, (int)distancias.size()),
+                        distancias.end());
+
+            // Retornar los k primeros como {id, distancia}
+            vector<pair<int, double>> resultado;
+            int num_vecinos = min(k, (int)distancias.size());
+            for(int i = 0; i < num_vecinos; i++) {
+                resultado.push_back({distancias[i].second, distancias[i].first});
+            }
+
+            return resultado;
+        }
+
+        // Constructor con parámetros del paper DB-LSH (según código original)
+        // D: dimensión original, L: número de tablas hash, C: approximation ratio
+        // R_min: radio inicial mínimo, t: parámetro de límite de accesos
+        // familia: tipo de proyección aleatoria (ver FamiliaHash)
+        // w0 = R_min * 4C² según código original del paper
+        DBLSH(int dim, int L_, double C_, double R_min_, double t_, unsigned seed_ = 42,
+              FamiliaHash familia_ = FamiliaHash::GAUSSIANA, bool verbose_ = true)
+            : D(dim), L(L_), C(C_), R_min(R_min_), t(t_), seed(seed_), verbose(verbose_), familia(familia_) {
+            if(DC != 0 && dim != static_cast<int>(DC)) {
+                throw runtime_error("DBLSH compilado para D = " + to_string(DC) + ", recibió D = " + to_string(dim));
+            }
+            w0 = R_min * 4.0 * C * C;  // Fórmula del código original
+            indices.resize(L);
+            generarFuncionesHash();
+
+            if(!verbose) return;
+            cout << "DB-LSH inicializado (según implementación original):" << endl;
+            cout << "  Dimensión original: " << D << "D" << (DC ? " (fija en compilación)" : "") << endl;
+            if(KT == 0 || KT >= K) cout << "  Dimensión proyectada: " << K << "D (R*-tree " << K << "D)" << endl;
+            else cout << "  Dimensión proyectada: " << K << "D (R*-tree " << KT << "D + filtro SoA)" << endl;
+            cout << "  Tablas hash: " << L << endl;
+            cout << "  C = " << C << ", R_min = " << R_min << ", t = " << t << endl;
+            cout << "  w0 = " << w0 << " (R_min * 4C²)" << endl;
+            cout << "  Familia hash: " << nombreFamilia(familia) << endl;
+            cout << "  Semilla: " << seed << endl;
+        }
+
+        // Formato del almacén de puntos usado en el próximo insertar().
+        // U8/I8 requieren coordenadas enteras (p.ej. píxeles 0-255) y
+        // calculan la distancia exacta con aritmética entera
+        void configurarAlmacen(FormatoPuntos formato_) {
+            formato = formato_;
+        }
+
+        // Activar el prefiltro PQ (se entrena en el próximo insertar()).
+        // M: número de subespacios (bytes por punto), fraccion: proporción de
+        // candidatos por ventana que reciben la distancia exacta
+        void configurarPQ(size_t M, double fraccion) {
+            pq_M = M;
+            pq_fraccion = clamp(fraccion, 0.0, 1.0);
+        }
+
+        // RC_NN_K en pipeline: `hilos` productores recorren las ventanas de las
+        // tablas siguientes mientras la query verifica los lotes ya recibidos
+        // (0 = desactivado)
+        void configurarPipeline(size_t hilos) {
+            productores = hilos > 0 ? make_shared<ThreadPool>(hilos) : nullptr;
+        }
+
+        void configurarPrefetch(size_t distancia) {
+            distancia_prefetch = distancia;
+        }
+
+        // confianza en (0, 1) activa la poda; confianza = 1 solo ordena
+        void configurarOrdenProyectado(bool activar, double confianza = 0.999) {
+            orden_proyectado = activar;
+            cuantil_chi2 = (confianza > 0.0 && confianza < 1.0) ? cuantilChi2(K, confianza) : 0.0;
+        }
+
+        // Aprender la distribución de distancias k-NN en el próximo insertar() con
+        // `muestra` puntos (0 = r *= c desde R_min). factor > 1 es el paso del
+        // galope, independiente de c
+        void configurarRadioAprendido(size_t muestra, size_t k_max = 100, double cuantil = 0.1, double factor = 2.0) {
+            if(muestra > 0 && (k_max == 0 || factor <= 1.0)) {
+                throw runtime_error("Radio aprendido: k_max debe ser > 0 y factor > 1");
+            }
+            muestra_radios = muestra;
+            k_max_radios = k_max;
+            cuantil_radio = clamp(cuantil, 0.0, 1.0);
+            factor_galope = factor;
+        }
+
+        // Menor r cuyas L ventanas de ancho w0·r centradas en G_i(q) contienen
+        // todas las proyecciones de su tabla. Con plazo es infinito: la
+        // fuerza bruta no respeta el presupuesto (como en planificar), así que
+        // se sigue con rondas, que sí lo hacen
+        double radioCubre(const ContextoConsulta& ctx) const {
+            if(ctx.plazo) return numeric_limits<double>::infinity();
+            double r = R_min;
+            for(int i = 0; i < L && i < static_cast<int>(minimos_proyeccion.size()); i++) {
+                for(size_t d = 0; d < K; d++) {
+                    double lejos = max(ctx.hashes[i][d] - minimos_proyeccion[i][d], maximos_proyeccion[i][d] - ctx.hashes[i][d]);
+                    r = max(r, 2.0 * lejos / w0);
+                }
+            }
+            return r;
+        }
+
+        // Radio inicial de C_ANN_K para k vecinos (R_min sin radio aprendido)
+        double radioInicial(int k) const {
+            if(radios_k.empty()) return R_min;
+            const vector<double>& dist = radios_k[min<size_t>(max(k, 1), radios_k.size()) - 1];
+            size_t pos = static_cast<size_t>(cuantil_radio * (dist.size() - 1));
+            return max(R_min, dist[pos]);
+        }
+
+        // Planificador por costo (se prepara en el próximo insertar()): en cada
+        // ronda estima con histogramas de las proyecciones cuántos puntos caen
+        // en la ventana de cada tabla y elige árbol o escaneo de la proyección
+        // plana (n·K doubles más por tabla), o fuerza bruta para toda la consulta
+        void configurarPlanificador(bool activar, const CostesPlan& costes = CostesPlan()) {
+            planificador = activar;
+            costes_plan = costes;
+        }
+
+        // Etiqueta (atributo) de cada punto del próximo insertar(), en orden de
+        // entrada. Las etiquetas con a lo sumo fraccion_subindice·n puntos
+        // reciben un sub-índice propio (0 = ninguno)
+        void configurarEtiquetas(vector<int> etiquetas, double fraccion_subindice_ = 0.0) {
+            etiquetas_entrada = move(etiquetas);
+            fraccion_subindice = clamp(fraccion_subindice_, 0.0, 1.0);
+        }
+
+        bool tieneEtiquetas() const { return !etiquetas_.empty(); }
+        int etiqueta(int id) const { return etiquetas_[interno(id)]; }
+        size_t numSubindices() const { return subindices.size(); }
+
+        // Filtro con los puntos cuya etiqueta está en `aceptadas`
+        FiltroPuntos filtroEtiquetas(const vector<int>& aceptadas) const {
+            if(etiquetas_.empty()) throw runtime_error("El índice no tiene etiquetas (configurarEtiquetas antes de insertar)");
+            set<int> conjunto(aceptadas.begin(), aceptadas.end());
+            FiltroPuntos f = filtroInternos([&](size_t j) { return conjunto.count(etiquetas_[j]) > 0; });
+            if(conjunto.size() == 1) {
+                f.de_etiqueta = true;
+                f.etiqueta = *conjunto.begin();
+            }
+            return f;
+        }
+
+        // Filtro con los puntos (id de la API) que cumplen pred(id)
+        template <typename Pred>
+        FiltroPuntos filtroSi(Pred pred) const {
+            return filtroInternos([&](size_t j) { return pred(externo(static_cast<int>(j))); });
+        }
+
+        // Orden físico del almacén para la próxima construcción
+        void configurarOrden(OrdenAlmacen orden_) {
+            orden = orden_;
+        }
+
+        // Limitar la memoria del índice a `bytes` (verificado al inicio de insertar())
+        void configurarPresupuesto(size_t bytes, PoliticaPresupuesto politica_) {
+            presupuesto = bytes;
+            politica = politica_;
+        }
+
+        // Estimación de memoria para n puntos con la configuración actual
+        ReporteMemoria estimarMemoria(size_t n) const {
+            ReporteMemoria r;
+            r.almacen = (en_disco ? min(n, filas_cache_disco) : n) * D * bytesPorCoordenada(formato);
+            r.proyeccion = bytesProyeccion();
+            r.arboles = static_cast<size_t>(L) * Arbol::bytesEstimados(n);
+            if(planificador) r.arboles += static_cast<size_t>(L) * ProyeccionPlana<K>::bytesEstimados(n);
+            if(pq_M > 0) r.pq = n * pq_M + ProductQuantizer::KSUB * D * sizeof(float);
+            // Construcción tabla a tabla: un único buffer de carga de n Value vivo
+            r.construccion_pico = Arbol::bytesCargaEstimados(n);
+            return r;
+        }
+
+        // Memoria real del índice construido
+        ReporteMemoria reporteMemoria() const {
+            ReporteMemoria r;
+            r.almacen = datos.bytes();
+            r.proyeccion = bytesProyeccion();
+            r.pq = pq.bytes();
+            size_t extra_arbol = 0;
+            for(const auto& indice : indices) {
+                r.arboles += indice.bytesNodos();
+                extra_arbol = max(extra_arbol, indice.bytesPico() - indice.bytesNodos());
+            }
+            for(const auto& [etiqueta, arboles] : subindices) {
+                for(const auto& indice : arboles) r.arboles += indice.bytesNodos();
+            }
+            for(const auto& plano : planos) r.arboles += plano.bytes();
+            for(const auto& h : histogramas) r.arboles += h.bytes();
+            r.almacen += etiquetas_.size() * sizeof(int);
+            r.construccion_pico = extra_arbol;
+            return r;
+        }
+
+        void imprimirMemoria() const {
+            imprimirReporteMemoria(reporteMemoria(), "Memoria del índice DB-LSH:");
+        }
+
+    private:
+        // Sub-índices de las etiquetas con a lo sumo fraccion_subindice·n puntos
+        template <typename Fila>
+        void construirSubindices(size_t n, Fila fila) {
+            subindices.clear();
+            if(fraccion_subindice <= 0.0 || etiquetas_.empty()) return;
+            TRACE_SCOPE("sub-índices");
+            map<int, vector<int>> miembros;
+            for(size_t j = 0; j < n; j++) miembros[etiquetas_[j]].push_back(static_cast<int>(j));
+            for(const auto& [etiqueta, ids] : miembros) {
+                if(ids.size() > fraccion_subindice * n) continue;
+                vector<Arbol>& arboles = subindices[etiqueta];
+                arboles.resize(L);
+                for(int i = 0; i < L; i++) {
+                    arboles[i].bulkLoadGenerado(ids.size(), [&](size_t j, array<double, K>& hash_punto) {
+                        hash_punto = funcionHash(fila(externo(ids[j])), i);
+                        return ids[j];
+                    });
+                }
+            }
+            if(verbose) {
+                cout << "Sub-índices por etiqueta: " << subindices.size() << " de " << miembros.size()
+                     << " etiquetas (≤ " << fraccion_subindice * 100.0 << "% de los puntos)" << endl;
+            }
+        }
+
+        // Construir el índice desde filas de entrada: fila(j) apunta a las D
+        // coordenadas del punto j (id de la API). almacenar(orden) llena `datos`
+        // al final, después de los árboles, para que un buffer recibido por
+        // move pueda adoptarse o liberarse sin haber coexistido con una copia
+        template <typename Fila, typename Almacenar>
+        void construir(size_t n, Fila fila, Almacenar almacenar) {
+            TRACE_SCOPE("insertar");
+            if(!etiquetas_entrada.empty() && etiquetas_entrada.size() != n) {
+                throw runtime_error(to_string(etiquetas_entrada.size()) + " etiquetas configuradas para "
+                                    + to_string(n) + " puntos");
+            }
+            aplicarPresupuesto(n);
+
+            // Orden físico (interno → externo)
+            externo_.clear();
+            interno_.clear();
+            if(orden == OrdenAlmacen::MORTON) externo_ = ordenMorton(n, fila);
+            else if(orden == OrdenAlmacen::KMEANS) externo_ = ordenKMeans(n, fila);
+            if(!externo_.empty()) {
+                interno_.resize(externo_.size());
+                for(size_t j = 0; j < externo_.size(); j++) interno_[externo_[j]] = static_cast<int>(j);
+            }
+            etiquetas_.assign(etiquetas_entrada.size(), 0);
+            for(size_t j = 0; j < etiquetas_.size(); j++) etiquetas_[j] = etiquetas_entrada[externo(static_cast<int>(j))];
+            vector<int>().swap(etiquetas_entrada);
+
+            if(verbose) {
+                cout << "\nIndexando " << n << " puntos de " << D << "D..." << endl;
+                cout << "Usando bulk-loading (paper DB-LSH)" << endl;
+            }
+
+            // Construcción tabla a tabla: las proyecciones de la tabla i se
+            // escriben directamente en el buffer de bulk-loading de su árbol
+            // (ID = fila en el almacén, interno), que se libera antes de pasar
+            // a la tabla siguiente. El pico transitorio es el de una sola tabla
+            // Con planificador, la misma pasada llena la proyección plana y
+            // toma la muestra del histograma (un punto cada n / MUESTRA)
+            histogramas.assign(planificador ? L : 0, HistogramaProyecciones<K>());
+            planos.assign(planificador ? L : 0, ProyeccionPlana<K>());
+            hojas_tabla.assign(planificador ? L : 0, 0);
+            const size_t paso_muestra = max<size_t>(1, n / HistogramaProyecciones<K>::MUESTRA);
+            array<double, K> vacia_min, vacia_max;
+            vacia_min.fill(numeric_limits<double>::infinity());
+            vacia_max.fill(-numeric_limits<double>::infinity());
+            minimos_proyeccion.assign(L, vacia_min);
+            maximos_proyeccion.assign(L, vacia_max);
+            for(int i = 0; i < L; i++) {
+                TRACE_SCOPE("proyectar tabla");
+                vector<array<double, K>> muestra;
+                if(planificador) planos[i].reservar(n);
+                indices[i].bulkLoadGenerado(n, [&](size_t j, array<double, K>& hash_punto) {
+                    hash_punto = funcionHash(fila(externo(static_cast<int>(j))), i);
+                    for(size_t d = 0; d < K; d++) {
+                        minimos_proyeccion[i][d] = min(minimos_proyeccion[i][d], hash_punto[d]);
+                        maximos_proyeccion[i][d] = max(maximos_proyeccion[i][d], hash_punto[d]);
+                    }
+                    if(planificador) {
+                        planos[i].asignar(j, hash_punto);
+                        if(j % paso_muestra == 0) muestra.push_back(hash_punto);
+                    }
+                    return static_cast<int>(j);
+                });
+                if(planificador) {
+                    histogramas[i].construir(muestra);
+                    hojas_tabla[i] = indices[i].estadisticas().hojas();
+                }
+            }
+            construirSubindices(n, fila);
+            if(verbose && planificador) {
+                size_t bytes = 0;
+                for(const auto& plano : planos) bytes += plano.bytes();
+                cout << "Planificador: histogramas de " << HistogramaProyecciones<K>::CUBETAS
+                     << " cubetas y proyección plana (" << bytes / (1024.0 * 1024.0) << " MB)" << endl;
+            }
+
+            if(verbose) {
+                cout << "Proyecciones generadas (primeros 5):" << endl;
+                for (size_t i = 0; i < min((size_t)5, n); i++) {
+                    auto hash = funcionHash(fila(i), 0);
+                    cout << "  Punto[" << i << "] " << D << "D -> Hash "<< K << "D: [";
+                    for(size_t k = 0; k < K; k++) {
+                        cout << hash[k];
+                        if(k < K-1) cout << ", ";
+                    }
+                    cout << "]" << endl;
+                }
+                if(n > 5) {
+                    cout << "  ... (" << (n - 5) << " más)" << endl;
+                }
+            }
+
+            almacenar(externo_.empty() ? nullptr : &externo_);
+            if(verbose) {
+                cout << "Almacén de puntos: " << nombreFormato(datos.formato()) << " ("
+                     << datos.bytes() / (1024.0 * 1024.0) << " MB" << (datos.esVista() ? ", vista externa" : "")
+                     << (datos.enDisco() ? ", en disco: caché de " + to_string(filas_cache_disco) + " filas" : "")
+                     << "), orden " << nombreOrden(orden) << endl;
+            }
+
+            aprenderRadios();
+
+            pq.clear();
+            if(pq_M > 0) {
+                TRACE_SCOPE("construir PQ");
+                pq.construir(datos, pq_M, 4096, 6, seed);
+                if(verbose) {
+                    cout << "Prefiltro PQ: M = " << pq_M << " (" << pq.bytes() / (1024.0 * 1024.0)
+                         << " MB), fracción verificada = " << pq_fraccion << endl;
+                }
+            }
+            if(verbose) cout << endl;
+        }
+
+    public:
+        // Filas sueltas: se copian al almacén en el formato configurado
+        void insertar(const vector<vector<double>>& datos_input){
+            en_disco = false;
+            for(size_t j = 0; j < datos_input.size(); j++) {
+                if(static_cast<int>(datos_input[j].size()) != D) {
+                    throw runtime_error("Punto " + to_string(j) + " debe tener " + to_string(D) + " dimensiones");
+                }
+            }
+            construir(datos_input.size(), [&](size_t j) { return datos_input[j].data(); },
+                      [&](const vector<int>* orden_filas) { datos.asignar(datos_input, D, formato, orden_filas); });
+        }
+
+        // Vista no propietaria (p.ej. sobre un mmap o un prefijo de un buffer
+        // compartido). En F64 y orden ENTRADA el almacén la referencia sin
+        // copiar: el buffer debe sobrevivir al índice. Si no, se copia
+        void insertar(const VistaMatriz& vista) {
+            en_disco = false;
+            if(static_cast<int>(vista.D) != D) {
+                throw runtime_error("Vista de " + to_string(vista.D) + " dimensiones, se esperaban " + to_string(D));
+            }
+            construir(vista.n, [&](size_t j) { return vista.fila(j); }, [&](const vector<int>* orden_filas) {
+                if(formato == FormatoPuntos::F64 && !orden_filas) datos.referenciar(vista);
+                else datos.asignarFilas(vista.n, D, formato, [&](size_t j) { return vista.fila(j); }, orden_filas);
+            });
+        }
+
+        // Buffer n×D contiguo por move: en F64 el almacén lo adopta (permutado
+        // en el sitio si hay orden); en otro formato se convierte y se libera
+        void insertar(vector<double>&& plano) {
+            if(plano.size() % D != 0) {
+                throw runtime_error("Buffer de " + to_string(plano.size()) + " valores no es múltiplo de D = " + to_string(D));
+            }
+            const size_t n = plano.size() / D;
+            en_disco = false;
+            construir(n, [&](size_t j) { return plano.data() + j * D; }, [&](const vector<int>* orden_filas) {
+                if(formato == FormatoPuntos::F64) {
+                    datos.adoptar(move(plano), D, orden_filas);
+                    return;
+                }
+                datos.asignarFilas(n, D, formato, [&](size_t j) { return plano.data() + j * D; }, orden_filas);
+                vector<double>().swap(plano);
+            });
+        }
+
+        // Fuera de memoria: filas_cache filas en la caché LRU, hilos_io hilos
+        // de pread y filas por lote de lectura en la verificación
+        void configurarDisco(size_t filas_cache, size_t hilos_io = 4, size_t bloque = 64) {
+            filas_cache_disco = filas_cache;
+            hilos_disco = hilos_io;
+            bloque_disco = max<size_t>(1, bloque);
+        }
+
+        // Archivo binario de puntos (disk_store.h) que se queda en disco: los
+        // árboles se construyen con L pasadas secuenciales por bloques y las
+        // consultas leen solo las filas de sus candidatos. El formato del
+        // almacén es el del archivo y el orden, el de entrada. filas > 0
+        // indexa solo las primeras `filas` del archivo
+        void insertarArchivo(const string& ruta, size_t filas = 0) {
+            construirDesdeArchivo(ruta, filas, true);
+        }
+
+        // Igual que insertarArchivo pero copiando las filas al almacén en
+        // memoria (en el formato del archivo), sin pasar por un buffer double
+        // de n×D: el transitorio es un bloque de ~1 MB
+        void cargarArchivo(const string& ruta, size_t filas = 0) {
+            construirDesdeArchivo(ruta, filas, false);
+        }
+
+    private:
+        void construirDesdeArchivo(const string& ruta, size_t filas_max, bool quedar_en_disco) {
+            ArchivoFilas archivo(ruta, 0, 0);
+            const EncabezadoPuntos& enc = archivo.encabezado();
+            if(static_cast<int>(enc.D) != D) {
+                throw runtime_error(ruta + " tiene " + to_string(enc.D) + " dimensiones, se esperaban " + to_string(D));
+            }
+            if(orden != OrdenAlmacen::ENTRADA) {
+                throw runtime_error("Desde archivo el almacén conserva el orden del archivo (OrdenAlmacen::ENTRADA)");
+            }
+            // El presupuesto puede cambiar `formato` en memoria; las filas se
+            // decodifican siempre con el del archivo
+            const FormatoPuntos formato_archivo = static_cast<FormatoPuntos>(enc.formato);
+            formato = formato_archivo;
+            en_disco = quedar_en_disco;
+            const size_t n = filas_max > 0 ? min<size_t>(filas_max, enc.n) : enc.n;
+            const size_t bytes_fila = archivo.bytesFila();
+            const size_t por_bloque = max<size_t>(1, (size_t(1) << 20) / bytes_fila);
+            vector<char> crudo;
+            vector<double> bloque;
+            size_t inicio = 0, filas = 0;
+            auto fila = [&](size_t j) -> const double* {
+                if(j < inicio || j >= inicio + filas) {
+                    inicio = j;
+                    filas = min(por_bloque, n - j);
+                    crudo.resize(filas * bytes_fila);
+                    archivo.leerSecuencial(inicio, filas, crudo.data());
+                    bloque.resize(filas * D);
+                    for(size_t f = 0; f < filas; f++) filaADouble(formato_archivo, &crudo[f * bytes_fila], D, &bloque[f * D]);
+                }
+                return &bloque[(j - inicio) * D];
+            };
+            construir(n, fila, [&](const vector<int>*) {
+                if(quedar_en_disco) datos.abrirArchivo(ruta, filas_cache_disco, hilos_disco, n);
+                else datos.asignarFilas(n, D, formato, fila);
+            });
+        }
+
+    public:
+        // Filas pedidas / aciertos de caché / preads / bytes leídos del almacén en disco
+        ArchivoFilas::Contadores contadoresDisco() const { return datos.contadoresDisco(); }
+
+        void imprimir(){
+            for(int i = 0; i < L; i++) {
+                indices[i].printStats();
+            }
+            imprimirMemoria();
+        }
+
+        // Métricas estructurales de cada tabla y nodos que tocan, en promedio,
+        // las ventanas de ancho w0·r centradas en G_i(q) de las consultas dadas
+        vector<DiagnosticoTabla> diagnosticoArboles(const vector<vector<double>>& consultas, double r) const {
+            vector<DiagnosticoTabla> tablas(L);
+            const double threshold = w0 * r / 2.0;
+            for(int i = 0; i < L; i++) {
+                tablas[i].arbol = indices[i].estadisticas();
+                for(const auto& q : consultas) {
+                    validarQuery(q);
+                    array<double, K> h = funcionHash(q, i);
+                    array<double, K> mins, maxs;
+                    for(size_t j = 0; j < K; j++) {
+                        mins[j] = h[j] - threshold;
+                        maxs[j] = h[j] + threshold;
+                    }
+                    VisitaVentana v = indices[i].nodosVisitados(mins, maxs);
+                    tablas[i].internos_por_ventana += v.internos;
+                    tablas[i].hojas_por_ventana += v.hojas;
+                    tablas[i].puntos_por_ventana += v.puntos;
+                }
+                if(!consultas.empty()) {
+                    tablas[i].internos_por_ventana /= consultas.size();
+                    tablas[i].hojas_por_ventana /= consultas.size();
+                    tablas[i].puntos_por_ventana /= consultas.size();
+                }
+            }
+            return tablas;
+        }
+
+        double anchoVentana(double r) const { return w0 * r; }
+
+
+        // Algorithm 1 (modificado): (r,c)-NN Query para k vecinos
+        // Input: q (query point), r (query radius), c (approximation ratio), k (num neighbors), T (límite de accesos)
+        // Output: Lista de hasta k puntos con {id, punto, distancia}
+        vector<tuple<int, vector<double>, double>> RC_NN_K(const vector<double>& query, double r, double c, int k, int T) const {
+            validarQuery(query);
+            return RC_NN_K(prepararConsulta(query), r, c, k, T);
+        }
+
+        // plan: el de C_ANN_K para esta ronda (nullptr = planificarla aquí). Una
+        // ronda suelta no cambia a fuerza bruta: eso lo decide C_ANN_K
+        vector<tuple<int, vector<double>, double>> RC_NN_K(const ContextoConsulta& ctx, double r, double c, int k, int T,
+                                                           const PlanRonda* plan = nullptr) const {
+            TRACE_SCOPE("RC_NN_K");
+            PlanRonda propio;
+            if(!plan) {
+                propio = planificar(ctx, r, T);
+                plan = &propio;
+            }
+            if(productores) return RC_NN_K_pipeline(ctx, r, c, k, T, *plan);
+
+            vector<tuple<int, vector<double>, double>> candidatos; // {id, punto, distancia}
+            set<int> ids_visitados; // Evitar duplicados entre tablas
+            int cnt = 0;
+            const vector<Arbol>& arboles = ctx.arboles ? *ctx.arboles : indices;
+
+            // Filtro aplicado a cada punto al salir del árbol: los rechazados no
+            // llegan a la verificación ni cuentan para T
+            auto admitir = [&](int id) {
+                if(!ctx.filtro || ctx.filtro->contiene(id)) return true;
+                if(ctx.estadisticas) ctx.estadisticas->filtrados++;
+                return false;
+            };
+
+            // Para cada tabla i = 1 to L
+            for(int i = 0; i < L; i++){
+                const array<double, K>& hash_query = ctx.hashes[i];
+                double w_r = w0 * r;
+                double threshold = w_r / 2.0;
+
+                array<double, K> mins, maxs;
+                for(size_t j = 0; j < K; j++) {
+                    mins[j] = hash_query[j] - threshold;
+                    maxs[j] = hash_query[j] + threshold;
+                }
+
+                const bool escaneo = !plan->tablas.empty() && plan->tablas[i] == PlanVentana::ESCANEO;
+                if(ctx.estadisticas) (escaneo ? ctx.estadisticas->plan_escaneo : ctx.estadisticas->plan_arbol)++;
+
+                vector<typename Arbol::Value> resultados;
+                vector<int> escaneados;   // Plan ESCANEO: ids de la proyección plana
+                if(escaneo) {
+                    size_t vistos = 0;
+                    bool completa = planos[i].escanearHasta(mins, maxs, [&](int id) {
+                        if(admitir(id)) escaneados.push_back(id);
+                        return !ctx.plazo || ++vistos % Plazo::PASO_RELOJ != 0 || !ctx.plazo->vencido();
+                    });
+                    if(!completa) return candidatos;
+                } else if(ctx.plazo) {
+                    // Recorrido incremental para poder abandonarlo al vencer el plazo
+                    size_t vistos = 0;
+                    bool completa = arboles[i].windowQueryHasta(mins, maxs, [&](const typename Arbol::Value& v) {
+                        if(admitir(v.second)) resultados.push_back(v);
+                        return ++vistos % Plazo::PASO_RELOJ != 0 || !ctx.plazo->vencido();
+                    });
+                    if(!completa) return candidatos;
+                } else if(ctx.filtro) {
+                    arboles[i].windowQuery(mins, maxs, [&](const typename Arbol::Value& v) {
+                        if(admitir(v.second)) resultados.push_back(v);
+                    });
+                } else {
+                    resultados = arboles[i].windowQuery(mins, maxs);
+                }
+
+                // Candidatos nuevos de esta ventana (evitar duplicados entre tablas).
+                // Con PQ se marcan en prefiltrarPQ, solo los que pasan el corte
+                vector<int> lote;
+                const bool marcar = !pq.activo();
+                auto agregarNuevos = [&](const auto& ventana, auto id_de, auto proyectada) {
+                    lote.reserve(ventana.size());
+                    if(orden_proyectado) {
+                        ordenarPorProyeccion(ventana, id_de, proyectada, c * r, marcar, ids_visitados, lote, ctx.estadisticas);
+                        return;
+                    }
+                    for(const auto& res : ventana) {
+                        int id = id_de(res);
+                        if(marcar ? ids_visitados.insert(id).second : !ids_visitados.count(id)) lote.push_back(id);
+                    }
+                };
+                if(escaneo) {
+                    agregarNuevos(escaneados, [](int id) { return id; },
+                                  [&](int id) { return planos[i].distancia2(id, hash_query); });
+                } else {
+                    agregarNuevos(resultados, [](const typename Arbol::Value& v) { return v.second; },
+                                  [&](const typename Arbol::Value& v) { return Arbol::distancia2(v.first, hash_query); });
+                }
+                if(pq.activo()) prefiltrarPQ(lote, ctx.tabla_pq, k, ids_visitados);
+
+                TRACE_SCOPE("verificar");
+                bool terminar = verificarIds(ctx.consulta, lote, [&](int id, double dist) {
+                    cnt++;
+                    if(ctx.estadisticas) ctx.estadisticas->verificados++;
+                    bool agotado = ctx.plazo && ctx.plazo->registrar(id, dist);
+
+                    // Agregar si dist ≤ cr
+                    if(dist <= c * r) {
+                        candidatos.push_back({externo(id), datos.fila(id), dist});
+                        if((int)candidatos.size() >= k) {
+                            return true; // Terminación temprana si ya tenemos k
+                        }
+                    }
+
+                    // Terminación por límite de accesos T (según código original) o por plazo
+                    return cnt >= T || agotado;
+                });
+                if(terminar) return candidatos;
+            }
+            return candidatos;
+        }
+
+        // RC_NN_K en pipeline: una tarea productora recorre las ventanas tabla por
+        // tabla (iteración incremental del R*-tree) y empuja lotes de ids a una cola
+        // acotada; este hilo deduplica y verifica. Al llegar a k o a T se cancela
+        // la cola y el productor abandona el recorrido en curso.
+        // Con PQ los ids de una tabla se acumulan hasta su último lote para
+        // prefiltrar igual que la versión secuencial. Las tablas con plan
+        // ESCANEO se recorren sobre la proyección plana
+        vector<tuple<int, vector<double>, double>> RC_NN_K_pipeline(const ContextoConsulta& ctx, double r, double c, int k, int T,
+                                                                    const PlanRonda& plan) const {
+            struct LoteIds {
+                vector<int> ids;
+                vector<double> proyectada;   // ||G(q) - G(o)||² (solo con orden_proyectado)
+                bool fin_tabla = false;
+            };
+            ColaAcotada<LoteIds> cola(PIPELINE_CAPACIDAD);
+            const double threshold = w0 * r / 2.0;
+            const vector<Arbol>& arboles = ctx.arboles ? *ctx.arboles : indices;
+            size_t filtrados = 0;   // Del productor: se suman a las estadísticas al final
+            size_t ventanas_arbol = 0, ventanas_escaneo = 0;
+
+            // La cola se cierra en toda salida del productor: si lanza, el
+            // consumidor sale de pop() y productor.get() relanza la excepción
+            future<void> productor = productores->enviar([&] {
+                TRACE_SCOPE("productor pipeline");
+                struct Cerrar {
+                    ColaAcotada<LoteIds>& cola;
+                    ~Cerrar() { cola.cerrar(); }
+                } cerrar{cola};
+                for(int i = 0; i < L && !cola.cancelada(); i++) {
+                    array<double, K> mins, maxs;
+                    for(size_t j = 0; j < K; j++) {
+                        mins[j] = ctx.hashes[i][j] - threshold;
+                        maxs[j] = ctx.hashes[i][j] + threshold;
+                    }
+                    LoteIds lote;
+                    lote.ids.reserve(PIPELINE_LOTE);
+                    size_t vistos = 0;
+                    // proyectada() = ||G(q) - G(o)||², solo se evalúa con orden_proyectado
+                    auto visitar = [&](int id, auto proyectada) {
+                        if(cola.cancelada()) return false;
+                        if(ctx.plazo && ++vistos % Plazo::PASO_RELOJ == 0 && ctx.plazo->vencido()) return false;
+                        if(ctx.filtro && !ctx.filtro->contiene(id)) {
+                            filtrados++;
+                            return true;
+                        }
+                        lote.ids.push_back(id);
+                        if(orden_proyectado) lote.proyectada.push_back(proyectada());
+                        if(lote.ids.size() < PIPELINE_LOTE) return true;
+                        if(!cola.push(move(lote))) return false;
+                        lote = LoteIds();
+                        lote.ids.reserve(PIPELINE_LOTE);
+                        if(orden_proyectado) lote.proyectada.reserve(PIPELINE_LOTE);
+                        return true;
+                    };
+                    bool completa;
+                    if(!plan.tablas.empty() && plan.tablas[i] == PlanVentana::ESCANEO) {
+                        ventanas_escaneo++;
+                        completa = planos[i].escanearHasta(mins, maxs, [&](int id) {
+                            return visitar(id, [&] { return planos[i].distancia2(id, ctx.hashes[i]); });
+                        });
+                    } else {
+                        ventanas_arbol++;
+                        completa = arboles[i].windowQueryHasta(mins, maxs, [&](const typename Arbol::Value& v) {
+                            return visitar(v.second, [&] { return Arbol::distancia2(v.first, ctx.hashes[i]); });
+                        });
+                    }
+                    if(!completa) break;
+                    lote.fin_tabla = true;
+                    if(!cola.push(move(lote))) break;
+                }
+            });
+            // El productor usa `cola` y `ctx`: cancelarlo y esperarlo al salir (también con excepción)
+            struct Esperar {
+                ColaAcotada<LoteIds>& cola;
+                future<void>& productor;
+                ~Esperar() { cola.cancelar(); if(productor.valid()) productor.wait(); }
+            } esperar{cola, productor};
+
+            vector<tuple<int, vector<double>, double>> candidatos;
+            set<int> ids_visitados;
+            vector<int> pendientes;
+            int cnt = 0;
+
+            // true = terminar (k candidatos o T accesos)
+            auto verificar = [&](int id, double dist) {
+                cnt++;
+                if(ctx.estadisticas) ctx.estadisticas->verificados++;
+                bool agotado = ctx.plazo && ctx.plazo->registrar(id, dist);
+                if(dist <= c * r) {
+                    candidatos.push_back({externo(id), datos.fila(id), dist});
+                    if((int)candidatos.size() >= k) return true;
+                }
+                return cnt >= T || agotado;
+            };
+
+            auto verificarTodos = [&](const vector<int>& ids) {
+                TRACE_SCOPE("verificar");
+                return verificarIds(ctx.consulta, ids, verificar);
+            };
+
+            // Con PQ u orden proyectado se espera al último lote de cada tabla.
+            // Con PQ los ids se marcan visitados en prefiltrarPQ, tras el corte
+            const bool por_tabla = pq.activo() || orden_proyectado;
+            const bool marcar = !pq.activo();
+            const double limite2 = limiteProyeccion2(c * r);
+            vector<pair<double, int>> orden_tabla;
+
+            LoteIds lote;
+            bool terminado = false;
+            while(!terminado && cola.pop(lote)) {
+                for(size_t j = 0; j < lote.ids.size(); j++) {
+                    int id = lote.ids[j];
+                    if(!orden_proyectado) {
+                        if(marcar ? ids_visitados.insert(id).second : !ids_visitados.count(id)) pendientes.push_back(id);
+                        continue;
+                    }
+                    if(ids_visitados.count(id)) continue;
+                    if(lote.proyectada[j] > limite2) {
+                        if(ctx.estadisticas) ctx.estadisticas->descartados++;
+                        continue;
+                    }
+                    if(marcar) ids_visitados.insert(id);
+                    orden_tabla.push_back({lote.proyectada[j], id});
+                }
+                if(por_tabla && !lote.fin_tabla) continue;
+                if(orden_proyectado) {
+                    sort(orden_tabla.begin(), orden_tabla.end());
+                    for(const auto& [d2, id] : orden_tabla) pendientes.push_back(id);
+                    orden_tabla.clear();
+                }
+                if(pq.activo()) prefiltrarPQ(pendientes, ctx.tabla_pq, k, ids_visitados);
+                terminado = verificarTodos(pendientes);
+                pendientes.clear();
+            }
+            cola.cancelar();
+            productor.get();  // Propagar excepciones del productor
+            if(ctx.estadisticas) {
+                ctx.estadisticas->filtrados += filtrados;
+                ctx.estadisticas->plan_arbol += ventanas_arbol;
+                ctx.estadisticas->plan_escaneo += ventanas_escaneo;
+            }
+            return candidatos;
+        }
+
+        // Búsqueda por rango: puntos con ||q - p|| ≤ r encontrados en alguna de las
+        // L ventanas de ancho w0·r (las mismas de RC_NN_K). Cada tabla es una tarea
+        // del pool: recorre su ventana sin acumularla, reclama los ids en un bitmap
+        // atómico compartido (cada punto se verifica una sola vez) y entrega los
+        // aciertos a callback(id, dist) en bloques. El callback se llama bajo un
+        // mutex, así que no necesita ser thread-safe. Retorna el número de resultados
+        template <typename F>
+        size_t rangeSearch(const vector<double>& query, double r, F&& callback, ThreadPool& pool) const {
+            validarQuery(query);
+            ContextoConsulta ctx = prepararConsulta(query);
+            const double threshold = w0 * r / 2.0;
+            const double r2 = r * r;
+            constexpr size_t BLOQUE = 256;
+
+            vector<atomic<uint64_t>> vistos((datos.size() + 63) / 64);
+            for(auto& palabra : vistos) palabra.store(0, memory_order_relaxed);
+            mutex mtx_callback;
+            atomic<size_t> total(0);
+
+            pool.paraCada(L, [&](size_t i) {
+                array<double, K> mins, maxs;
+                for(size_t j = 0; j < K; j++) {
+                    mins[j] = ctx.hashes[i][j] - threshold;
+                    maxs[j] = ctx.hashes[i][j] + threshold;
+                }
+
+                vector<pair<int, double>> bloque;
+                bloque.reserve(BLOQUE);
+                auto vaciar = [&] {
+                    if(bloque.empty()) return;
+                    total += bloque.size();
+                    lock_guard<mutex> lock(mtx_callback);
+                    for(const auto& [id, dist] : bloque) callback(id, dist);
+                    bloque.clear();
+                };
+
+                indices[i].windowQuery(mins, maxs, [&](const typename Arbol::Value& v) {
+                    int id = v.second;
+                    uint64_t bit = uint64_t(1) << (id & 63);
+                    if(vistos[id >> 6].fetch_or(bit, memory_order_relaxed) & bit) return;
+                    double dist2 = datos.distancia2<DC>(ctx.consulta, id);
+                    if(dist2 > r2) return;
+                    bloque.push_back({externo(id), std::sqrt(dist2)});
+                    if(bloque.size() == BLOQUE) vaciar();
+                });
+                vaciar();
+            });
+            return total.load();
+        }
+
+        // Algorithm 2 (modificado según código original): c-ANN Query para k vecinos
+        // Input: q (query point), c (approximation ratio), k (num neighbors)
+        // Output: Lista de min(k, n) puntos con {id, punto, distancia}; vacía si k ≤ 0
+        vector<tuple<int, vector<double>, double>> C_ANN_K(const vector<double>& query, double c, int k,
+                                                           EstadisticasConsulta* estadisticas = nullptr) const {
+            validarQuery(query);
+            k = min(k, getDatasetSize());
+            if(k <= 0) return {};
+            ContextoConsulta ctx = prepararConsulta(query);
+            ctx.estadisticas = estadisticas;
+            return C_ANN_K(ctx, c, k);
+        }
+
+        // Consulta anytime: si el presupuesto se agota antes de terminar, retorna
+        // los k mejores puntos verificados hasta entonces (sin la garantía c) y
+        // suma 1 a estadisticas->parciales
+        vector<tuple<int, vector<double>, double>> C_ANN_K(const vector<double>& query, double c, int k,
+                                                           const LimitesConsulta& limites,
+                                                           EstadisticasConsulta* estadisticas = nullptr) const {
+            validarQuery(query);
+            k = min(k, getDatasetSize());
+            if(k <= 0) return {};
+            Plazo plazo(limites, k);
+            ContextoConsulta ctx = prepararConsulta(query);
+            ctx.estadisticas = estadisticas;
+            if(limites.activo()) ctx.plazo = &plazo;
+            return C_ANN_K(ctx, c, k);
+        }
+
+        // c-ANN restringida a los puntos del filtro, que se descartan al salir de
+        // cada ventana (antes de la distancia exacta y sin contar para T). k se
+        // limita a los puntos admitidos; el radio inicial aprendido se toma
+        // para k / selectividad, el k equivalente sin filtro
+        vector<tuple<int, vector<double>, double>> C_ANN_K(const vector<double>& query, double c, int k,
+                                                           const FiltroPuntos& filtro,
+                                                           const LimitesConsulta& limites = {},
+                                                           EstadisticasConsulta* estadisticas = nullptr) const {
+            validarQuery(query);
+            k = min(k, static_cast<int>(filtro.seleccionados));
+            if(k <= 0) return {};
+            Plazo plazo(limites, k);
+            ContextoConsulta ctx = prepararConsulta(query);
+            ctx.estadisticas = estadisticas;
+            if(limites.activo()) ctx.plazo = &plazo;
+            aplicarFiltro(ctx, filtro);
+            return C_ANN_K(ctx, c, k);
+        }
+
+        // Consultas por lotes: proyección conjunta y búsquedas en paralelo en el pool.
+        // Con limites cada query tiene su propio plazo, contado desde que empieza.
+        // Como en C_ANN_K, k se limita a n y con k ≤ 0 las respuestas quedan vacías
+        vector<vector<tuple<int, vector<double>, double>>> C_ANN_K_lote(const vector<vector<double>>& queries,
+                                                                         double c, int k, ThreadPool& pool,
+                                                                         const LimitesConsulta& limites = {},
+                                                                         vector<EstadisticasConsulta>* estadisticas = nullptr) const {
+            k = min(k, getDatasetSize());
+            vector<ContextoConsulta> ctxs = prepararLote(queries);
+            vector<vector<tuple<int, vector<double>, double>>> resultados(queries.size());
+            if(estadisticas) estadisticas->assign(queries.size(), EstadisticasConsulta());
+            if(k <= 0) return resultados;
+            pool.paraCada(queries.size(), [&](size_t b) {
+                if(estadisticas) ctxs[b].estadisticas = &(*estadisticas)[b];
+                if(!limites.activo()) {
+                    resultados[b] = C_ANN_K(ctxs[b], c, k);
+                    return;
+                }
+                Plazo plazo(limites, k);
+                ctxs[b].plazo = &plazo;
+                resultados[b] = C_ANN_K(ctxs[b], c, k);
+                ctxs[b].plazo = nullptr;
+            });
+            return resultados;
+        }
+
+        vector<tuple<int, vector<double>, double>> C_ANN_K(const ContextoConsulta& ctx, double c, int k) const {
+            // Calcular parámetro t adaptativo según tamaño N (código original)
+            // int N = datos.size();
+            //double t = 1.0;
+            // if (N < 70000) {
+            //     t = 200.0;
+            // } else if (N >= 70000 && N < 500000) {
+            //     t = 1000.0;
+            // } else if (N >= 500000 && N < 2000000) {
+            //     t = 2000.0;
+            // } else if (N >= 2000000 && N < 2000000000) {
+            //     t = 20000.0;
+            // } else {
+            //     t = 20000.0;
+            // }
+            // t *= 2.0;
+
+            int T = 2*t*L + k;
+            if(!radios_k.empty()) return C_ANN_K_galope(ctx, c, k, T);
+            double r = R_min;
+            const double r_cubre = radioCubre(ctx);
+
+
+            // Acumular candidatos entre iteraciones con IDs
+            vector<tuple<int, vector<double>, double>> acumulados;
+            set<int> ids_usados; // Para evitar duplicados usando IDs reales
+            double gastado = 0.0;   // ns estimados de las rondas (planificador)
+
+            // int rounds = 0;
+            // const int MAX_ROUNDS = 30;  // Límite de 30 rondas (código original)
+
+            while(true){
+                // rounds++;
+                if(ctx.plazo && ctx.plazo->vencido()) return respuestaParcial(ctx);
+                if(ctx.estadisticas) ctx.estadisticas->rondas++;
+                PlanRonda plan = planificar(ctx, r, T, gastado);
+                if(plan.fuerza_bruta) {
+                    if(ctx.estadisticas) ctx.estadisticas->radio = r;
+                    return fuerzaBruta(ctx, k);
+                }
+                gastado += plan.coste;
+                auto nuevos = RC_NN_K(ctx, r, c, k, T, &plan);  // r = init_w/w0
+
+                // Agregar nuevos candidatos evitando duplicados
+                for(const auto& candidato : nuevos) {
+                    int id = get<0>(candidato);
+
+                    if(ids_usados.find(id) == ids_usados.end()) {
+                        ids_usados.insert(id);
+                        acumulados.push_back(candidato);
+                    }
+                }
+
+                if((int)acumulados.size() >= k) {
+                    if(ctx.estadisticas) ctx.estadisticas->radio = r;
+                    // Ordenar por distancia y retornar los k mejores
+                    sort(acumulados.begin(), acumulados.end(),
+                         [](const auto& a, const auto& b) { return get<2>(a) < get<2>(b); });
+
+                    acumulados.resize(min(k, (int)acumulados.size()));
+                    return acumulados;
+                }
+
+                // Con la ventana cubriendo todas las proyecciones otra ronda
+                // no agrega candidatos: se termina con la respuesta exacta
+                if(r >= r_cubre) {
+                    if(ctx.estadisticas) ctx.estadisticas->radio = r;
+                    return fuerzaBruta(ctx, k);
+                }
+
+                // Expandir ventana w para siguiente iteración (código original)
+                r *= c;
+            }
+
+            // Si no se encontraron k vecinos después de MAX_ROUNDS, retornar lo acumulado
+            sort(acumulados.begin(), acumulados.end(),
+                 [](const auto& a, const auto& b) { return get<2>(a) < get<2>(b); });
+            return acumulados;
+        }
+
+        // C_ANN_K con radio aprendido. Una ronda a radio r tiene éxito si hay k
+        // candidatos verificados a distancia ≤ c·r. Desde r = radioInicial(k):
+        //  1. galope: ×factor_galope (o ÷ si ya tiene éxito) hasta acotar
+        //     lo < hi con lo fallida y hi exitosa (o hasta R_min)
+        //  2. bisección geométrica de [lo, hi] hasta hi/lo ≤ c
+        // Al terminar, la ronda en hi/c falló como la r/c anterior de r *= c,
+        // así que la garantía de aproximación es la misma con O(log) rondas.
+        // Con el plazo vencido las rondas no se ejecutan y cuentan como exitosas:
+        // los tres bucles terminan sin más trabajo y se retorna la respuesta parcial.
+        // Lo mismo si el planificador pasa a fuerza bruta: la respuesta es exacta
+        vector<tuple<int, vector<double>, double>> C_ANN_K_galope(const ContextoConsulta& ctx, double c, int k, int T) const {
+            vector<tuple<int, vector<double>, double>> acumulados;
+            set<int> ids_usados;
+            bool cortada = false;
+            double radio_exacta = 0.0;   // > 0: ronda que pasó a fuerza bruta
+            double gastado = 0.0;        // ns estimados de las rondas (planificador)
+            auto ronda = [&](double r) {
+                if(radio_exacta > 0.0) return true;
+                if(ctx.plazo && ctx.plazo->vencido()) return cortada = true;
+                if(ctx.estadisticas) ctx.estadisticas->rondas++;
+                PlanRonda plan = planificar(ctx, r, T, gastado);
+                if(plan.fuerza_bruta) {
+                    acumulados = fuerzaBruta(ctx, k);
+                    radio_exacta = r;
+                    return true;
+                }
+                gastado += plan.coste;
+                for(auto& candidato : RC_NN_K(ctx, r, c, k, T, &plan)) {
+                    if(ids_usados.insert(get<0>(candidato)).second) acumulados.push_back(move(candidato));
+                }
+                int dentro = 0;
+                for(const auto& candidato : acumulados) {
+                    if(get<2>(candidato) <= c * r) dentro++;
+                }
+                if(dentro >= k) return true;
+                return cortada = ctx.plazo && ctx.plazo->vencido();
+            };
+
+            double r = radioInicial(static_cast<int>(min(1e9, ceil(k / ctx.selectividad))));
+            double lo = 0.0, hi = 0.0;
+            if(ronda(r)) {
+                hi = r;
+                while(hi > R_min) {
+                    double menor = max(R_min, hi / factor_galope);
+                    if(!ronda(menor)) { lo = menor; break; }
+                    hi = menor;
+                }
+            } else {
+                // Hacia arriba el galope termina a más tardar en radioCubre (sin plazo):
+                // si esa ronda también falla, más radio no agrega candidatos
+                // y la respuesta pasa a ser la exacta
+                const double r_cubre = radioCubre(ctx);
+                lo = r;
+                while(true) {
+                    if(lo >= r_cubre) {
+                        acumulados = fuerzaBruta(ctx, k);
+                        radio_exacta = hi = lo;
+                        break;
+                    }
+                    double mayor = min(lo * factor_galope, r_cubre);
+                    if(ronda(mayor)) { hi = mayor; break; }
+                    lo = mayor;
+                }
+            }
+            while(lo > 0.0 && hi / lo > c) {
+                double medio = sqrt(lo * hi);
+                if(ronda(medio)) hi = medio;
+                else lo = medio;
+            }
+            if(cortada) return respuestaParcial(ctx);
+            if(radio_exacta > 0.0) {
+                if(ctx.estadisticas) ctx.estadisticas->radio = radio_exacta;
+                return acumulados;
+            }
+            if(ctx.estadisticas) ctx.estadisticas->radio = hi;
+
+            sort(acumulados.begin(), acumulados.end(),
+                 [](const auto& a, const auto& b) { return get<2>(a) < get<2>(b); });
+            acumulados.resize(min(k, (int)acumulados.size()));
+            return acumulados;
+        }
+
+        int getDatasetSize() const { return datos.size(); }
+        vector<double> punto(int id) const { return datos.fila(interno(id)); }
+        size_t bytesAlmacen() const { return datos.bytes(); }
+        size_t bytesPQ() const { return pq.bytes(); }
+
+        // Bytes de los parámetros de las funciones hash
+        size_t bytesProyeccion() const {
+            size_t total = static_cast<size_t>(a.size()) * K * bloques_fila * sizeof(BloqueAlineado);
+            for(const auto& s : signos1) total += s.size() * sizeof(double);
+            for(const auto& s : signos2) total += s.size() * sizeof(double);
+            total += filas_hadamard.size() * sizeof(array<size_t, K>);
+            for(const auto& p : dispersas) {
+                total += p.inicio.size() * sizeof(size_t) + p.columna.size() * sizeof(int)
+                       + p.valor.size() * sizeof(double);
+            }
+            return total;
+        }
+};
+
+#endif // DBLSH_H
@@ -5,24 +5,85 @@
 #include <string>
 #include <array>
 #include <type_traits>
+#include <cmath>
+#include <algorithm>
 #include <boost/geometry.hpp>
 #include <boost/geometry/index/rtree.hpp>
+#include <boost/geometry/index/detail/rtree/utilities/view.hpp>
+#include <boost/iterator/function_output_iterator.hpp>
+#include "memory_tracking.h"
+#include "trace.h"
 
 using namespace std;
 
 namespace bg = boost::geometry;
 namespace bgi = boost::geometry::index;
 
+// Métricas de un nivel del R*-tree (nivel 0 = raíz). Los volúmenes se llevan
+// en log10 porque en K dimensiones el producto de lados sale de rango; los MBR
+// de volumen 0 (un solo punto, lados nulos) no entran en las medias de volumen
+struct NivelArbol {
+    size_t nodos = 0;
+    size_t entradas = 0;                // Hijos (nodo interno) o puntos (hoja)
+    size_t con_volumen = 0;             // Nodos con MBR de volumen > 0
+    double suma_log10_volumen = 0.0;
+    double suma_margen = 0.0;           // Suma de lados del MBR (criterio del R*)
+    size_t pares = 0;                   // Pares de hermanos de este nivel
+    size_t pares_solapados = 0;         // ... cuyos MBR se intersectan
+    double suma_solapamiento = 0.0;     // Σ vol(a∩b) / min(vol a, vol b) sobre los pares
+    size_t padres = 0;                  // Nodos de este nivel con hijos que son cajas
+    double suma_espacio_muerto = 0.0;   // Σ max(0, 1 - Σvol(hijos)/vol(nodo))
+
+    double llenado(size_t capacidad) const { return nodos ? entradas / double(nodos * capacidad) : 0.0; }
+    double log10Volumen() const { return con_volumen ? suma_log10_volumen / con_volumen : 0.0; }
+    double margen() const { return nodos ? suma_margen / nodos : 0.0; }
+    double fraccionSolapada() const { return pares ? double(pares_solapados) / pares : 0.0; }
+    double solapamiento() const { return pares ? suma_solapamiento / pares : 0.0; }
+    double espacioMuerto() const { return padres ? suma_espacio_muerto / padres : 0.0; }
+};
+
+struct EstadisticasArbol {
+    size_t capacidad = 0;               // Máximo de entradas por nodo
+    size_t elementos = 0;
+    vector<NivelArbol> niveles;         // niveles.size() = altura
+
+    size_t altura() const { return niveles.size(); }
+    size_t nodos() const {
+        size_t n = 0;
+        for(const auto& nv : niveles) n += nv.nodos;
+        return n;
+    }
+    size_t hojas() const { return niveles.empty() ? 0 : niveles.back().nodos; }
+    double llenadoMedio() const {
+        size_t entradas = 0;
+        for(const auto& nv : niveles) entradas += nv.entradas;
+        size_t n = nodos();
+        return n ? entradas / double(n * capacidad) : 0.0;
+    }
+};
+
+// Nodos recorridos por una window query (mismo criterio de poda que bgi::intersects)
+struct VisitaVentana {
+    size_t internos = 0;
+    size_t hojas = 0;
+    size_t puntos = 0;                  // Puntos dentro de la ventana
+};
+
 template <size_t Dim>
 class RStarTreeIndex {
 public:
     using Point = bg::model::point<double, Dim, bg::cs::cartesian>;
     using Box = bg::model::box<Point>;
     using Value = pair<Point, int>; // par de punto y ID
+    using Allocator = TrackingAllocator<Value>;
+    static constexpr size_t MAX_ELEMENTOS = 16;
+    // R*-tree con parámetro 16 (máximo de elementos por nodo); los nodos se
+    // reservan con un allocator que contabiliza sus bytes
+    using RTree = bgi::rtree<Value, bgi::rstar<MAX_ELEMENTOS>, bgi::indexable<Value>, bgi::equal_to<Value>, Allocator>;
     
 private:
-    // R*-tree con parámetro 16 (máximo de elementos por nodo)
-    bgi::rtree<Value, bgi::rstar<16>> rtree_;
+    Allocator allocator_;
+    RTree rtree_;
     int total_elements_;
 
     template <size_t I = 0>
@@ -33,10 +94,180 @@ private:
         bg::set<I>(p, data[I]);
         fillPoint<I + 1>(p, data);
     }
+
+    using Vista = bgi::detail::rtree::utilities::view<RTree>;
+    using Miembros = typename Vista::members_holder;
+
+    // Lados de una caja (recorrido en tiempo de compilación)
+    template <size_t I = 0>
+    static std::enable_if_t<I == Dim> lados(const Box&, std::array<double, Dim>&) {}
+
+    template <size_t I = 0>
+    static std::enable_if_t<I < Dim> lados(const Box& b, std::array<double, Dim>& l) {
+        l[I] = bg::get<bg::max_corner, I>(b) - bg::get<bg::min_corner, I>(b);
+        lados<I + 1>(b, l);
+    }
+
+    // log10 del volumen (-inf si algún lado es nulo) y margen de una caja
+    static void medir(const Box& b, double& log10_volumen, double& margen) {
+        std::array<double, Dim> l;
+        lados(b, l);
+        log10_volumen = 0.0;
+        margen = 0.0;
+        for(double lado : l) {
+            margen += lado;
+            log10_volumen += lado > 0.0 ? log10(lado) : -INFINITY;
+        }
+    }
+
+    // log10 del volumen de a∩b (-inf si no se intersectan)
+    template <size_t I = 0>
+    static std::enable_if_t<I == Dim, double> log10Interseccion(const Box&, const Box&) { return 0.0; }
+
+    template <size_t I = 0>
+    static std::enable_if_t<I < Dim, double> log10Interseccion(const Box& a, const Box& b) {
+        double lado = min(bg::get<bg::max_corner, I>(a), bg::get<bg::max_corner, I>(b))
+                    - max(bg::get<bg::min_corner, I>(a), bg::get<bg::min_corner, I>(b));
+        if(lado <= 0.0) return -INFINITY;
+        return log10(lado) + log10Interseccion<I + 1>(a, b);
+    }
+
+    // Visitante de Boost que acumula EstadisticasArbol por nivel. La caja de
+    // cada nodo está en su padre, así que los hijos se miden desde el padre
+    struct VisitanteEstadisticas : public Miembros::visitor_const {
+        using Interno = typename Miembros::internal_node;
+        using Hoja = typename Miembros::leaf;
+
+        EstadisticasArbol& est;
+        size_t nivel = 0;
+        double log10_volumen_actual = 0.0;   // Caja del nodo que se está visitando
+
+        explicit VisitanteEstadisticas(EstadisticasArbol& e) : est(e) {}
+
+        NivelArbol& nivelActual() {
+            if(est.niveles.size() <= nivel) est.niveles.resize(nivel + 1);
+            return est.niveles[nivel];
+        }
+
+        void operator()(const Interno& n) {
+            const auto& hijos = bgi::detail::rtree::elements(n);
+            nivelActual().nodos++;
+            nivelActual().entradas += hijos.size();
+
+            vector<double> log10_vol(hijos.size());
+            double suma_hijos = 0.0;
+            nivel++;
+            NivelArbol& sig = nivelActual();
+            for(size_t a = 0; a < hijos.size(); a++) {
+                double margen;
+                medir(hijos[a].first, log10_vol[a], margen);
+                sig.suma_margen += margen;
+                if(std::isfinite(log10_vol[a])) {
+                    sig.con_volumen++;
+                    sig.suma_log10_volumen += log10_vol[a];
+                    if(std::isfinite(log10_volumen_actual)) suma_hijos += pow(10.0, log10_vol[a] - log10_volumen_actual);
+                }
+            }
+            for(size_t a = 0; a < hijos.size(); a++) {
+                for(size_t b = a + 1; b < hijos.size(); b++) {
+                    sig.pares++;
+                    if(!bg::intersects(hijos[a].first, hijos[b].first)) continue;
+                    sig.pares_solapados++;
+                    double menor = min(log10_vol[a], log10_vol[b]);
+                    if(std::isfinite(menor)) {
+                        sig.suma_solapamiento += pow(10.0, log10Interseccion(hijos[a].first, hijos[b].first) - menor);
+                    }
+                }
+            }
+            nivel--;
+            if(std::isfinite(log10_volumen_actual)) {
+                NivelArbol& actual = nivelActual();
+                actual.padres++;
+                actual.suma_espacio_muerto += max(0.0, 1.0 - suma_hijos);
+            }
+
+            double guardado = log10_volumen_actual;
+            nivel++;
+            for(size_t a = 0; a < hijos.size(); a++) {
+                log10_volumen_actual = log10_vol[a];
+                bgi::detail::rtree::apply_visitor(*this, *hijos[a].second);
+            }
+            nivel--;
+            log10_volumen_actual = guardado;
+        }
+
+        void operator()(const Hoja& n) {
+            nivelActual().nodos++;
+            nivelActual().entradas += bgi::detail::rtree::elements(n).size();
+        }
+    };
+
+    // Visitante que repite la poda de una window query contando nodos
+    struct VisitanteVentana : public Miembros::visitor_const {
+        using Interno = typename Miembros::internal_node;
+        using Hoja = typename Miembros::leaf;
+
+        const Box& ventana;
+        VisitaVentana visita;
+
+        explicit VisitanteVentana(const Box& v) : ventana(v) {}
+
+        void operator()(const Interno& n) {
+            visita.internos++;
+            for(const auto& hijo : bgi::detail::rtree::elements(n)) {
+                if(bg::intersects(hijo.first, ventana)) bgi::detail::rtree::apply_visitor(*this, *hijo.second);
+            }
+        }
+
+        void operator()(const Hoja& n) {
+            visita.hojas++;
+            for(const auto& v : bgi::detail::rtree::elements(n)) {
+                if(bg::intersects(v.first, ventana)) visita.puntos++;
+            }
+        }
+    };
+
+    // Visitante que recorre las hojas en profundidad (el orden de las window
+    // queries) reemplazando el ID de cada valor. Los nodos no son const (solo
+    // la vista lo es) y el ID no interviene en la geometría, así que el árbol
+    // sigue siendo válido
+    template <typename F>
+    struct VisitanteRenumerar : public Miembros::visitor_const {
+        using Interno = typename Miembros::internal_node;
+        using Hoja = typename Miembros::leaf;
+
+        F& nuevo_id;
+
+        explicit VisitanteRenumerar(F& f) : nuevo_id(f) {}
+
+        void operator()(const Interno& n) {
+            for(const auto& hijo : bgi::detail::rtree::elements(n)) {
+                bgi::detail::rtree::apply_visitor(*this, *hijo.second);
+            }
+        }
+
+        void operator()(const Hoja& n) {
+            for(const auto& v : bgi::detail::rtree::elements(n)) {
+                const_cast<Value&>(v).second = nuevo_id(v.second);
+            }
+        }
+    };
     
 public:
     // Constructor
-    RStarTreeIndex() : total_elements_(0) {};
+    RStarTreeIndex()
+        : allocator_(), rtree_(bgi::rstar<MAX_ELEMENTOS>(), bgi::indexable<Value>(), bgi::equal_to<Value>(), allocator_),
+          total_elements_(0) {};
+
+    // ||p - a||² entre un punto del árbol y coordenadas proyectadas
+    template <size_t I = 0>
+    static std::enable_if_t<I == Dim, double> distancia2(const Point&, const std::array<double, Dim>&) { return 0.0; }
+
+    template <size_t I = 0>
+    static std::enable_if_t<I < Dim, double> distancia2(const Point& p, const std::array<double, Dim>& a) {
+        double d = bg::get<I>(p) - a[I];
+        return d * d + distancia2<I + 1>(p, a);
+    }
 
     void insertPrueba(int id , array<double,Dim> data) {
         Point p;
@@ -46,21 +277,39 @@ public:
     }
     
     // Bulk-loading: construccion eficiente del R*-tree (Dim-dimensional)
-    void bulkLoad(const vector<pair<array<double, Dim>, int>>& data) {
-        vector<Value> values;
-        values.reserve(data.size());
+    // Contenedor: cualquier secuencia de pair<array<double, Dim>, int>
+    template <typename Contenedor>
+    void bulkLoad(const Contenedor& data) {
+        auto it = data.begin();
+        bulkLoadGenerado(data.size(), [&](size_t, array<double, Dim>& coords) {
+            coords = it->first;
+            return (it++)->second;
+        });
+    }
 
-        for (const auto& item : data) {
-            const auto& hash_array = item.first;
-            int id = item.second;
+    // Bulk-loading sin contenedor intermedio: generar(j, coords) escribe las
+    // coordenadas del elemento j y retorna su ID; va directo al buffer de carga
+    template <typename F>
+    void bulkLoadGenerado(size_t n, F generar) {
+        TRACE_SCOPE("bulkLoad");
+        // El buffer temporal también se contabiliza (pico de construcción)
+        rtree_.clear();
+        allocator_.contador->reiniciarPico();
+        vector<Value, Allocator> values(allocator_);
+        values.reserve(n);
+
+        array<double, Dim> coords;
+        for(size_t j = 0; j < n; j++) {
+            int id = generar(j, coords);
             Point p;
-            fillPoint(p, hash_array);
+            fillPoint(p, coords);
             values.push_back(std::make_pair(p, id));
         }
 
         // Reconstruir R*-tree usando bulk-loading (mas eficiente)
-        rtree_.clear();
-        rtree_ = bgi::rtree<Value, bgi::rstar<16>>(values.begin(), values.end());
+        RTree construido(values.begin(), values.end(), bgi::rstar<MAX_ELEMENTOS>(), bgi::indexable<Value>(),
+                         bgi::equal_to<Value>(), allocator_);
+        rtree_.swap(construido);
         total_elements_ = static_cast<int>(values.size());
     }
     
@@ -76,6 +325,7 @@ public:
 
     // Window Query: buscar puntos dentro de un hiper-rectángulo
     vector<Value> windowQuery(const array<double,Dim>& mins, const array<double,Dim>& maxs) const {
+        TRACE_SCOPE("windowQuery");
         Point p_min, p_max;
         fillPoint(p_min, mins);
         fillPoint(p_max, maxs);
@@ -85,6 +335,30 @@ public:
         return result;
     }
     
+    // Window Query sin acumular resultados: visitar(value) por cada punto de la ventana
+    template <typename F>
+    void windowQuery(const array<double,Dim>& mins, const array<double,Dim>& maxs, F visitar) const {
+        TRACE_SCOPE("windowQuery");
+        Point p_min, p_max;
+        fillPoint(p_min, mins);
+        fillPoint(p_max, maxs);
+        rtree_.query(bgi::intersects(Box(p_min, p_max)), boost::make_function_output_iterator(visitar));
+    }
+
+    // Window Query incremental (iteradores qbegin/qend): visitar(value) retorna
+    // false para abandonar el recorrido. Retorna true si se recorrió completa
+    template <typename F>
+    bool windowQueryHasta(const array<double,Dim>& mins, const array<double,Dim>& maxs, F visitar) const {
+        TRACE_SCOPE("windowQuery incremental");
+        Point p_min, p_max;
+        fillPoint(p_min, mins);
+        fillPoint(p_max, maxs);
+        for(auto it = rtree_.qbegin(bgi::intersects(Box(p_min, p_max))); it != rtree_.qend(); ++it) {
+            if(!visitar(*it)) return false;
+        }
+        return true;
+    }
+
     // Window Query alternativo: usando un Box directamente
     vector<Value> windowQuery(const Box& query_box) const {
         vector<Value> result;
@@ -93,18 +367,83 @@ public:
         return result;
     }
 
+    // Reemplazar el ID de cada valor por nuevo_id(id), hoja por hoja en el
+    // orden en que las recorren las window queries
+    template <typename F>
+    void renumerarHojas(F nuevo_id) {
+        if(rtree_.empty()) return;
+        VisitanteRenumerar<F> vis(nuevo_id);
+        Vista(rtree_).apply_visitor(vis);
+    }
+
     // Limpiar el índice
     void clear() {
         rtree_.clear();
         total_elements_ = 0;
     }
 
+    // Bytes vivos en nodos del árbol (contabilizados por el allocator)
+    size_t bytesNodos() const {
+        return static_cast<size_t>(allocator_.contador->actual.load());
+    }
+
+    // Pico de bytes durante la última construcción (nodos + buffer de bulk-load)
+    size_t bytesPico() const {
+        return static_cast<size_t>(allocator_.contador->pico.load());
+    }
+
+    // Estimación de los nodos para n puntos: el packing de Boost deja las
+    // hojas a ~mitad de capacidad (8 de 16 valores); cada nodo reserva 17 y
+    // hay ~1/15 de nodos internos extra
+    static size_t bytesEstimados(size_t n) {
+        size_t hojas = (n + 7) / 8;
+        return hojas * (17 * sizeof(Value) + 16) * 16 / 15;
+    }
+
+    // Buffer de carga de bulkLoadGenerado para n puntos
+    static size_t bytesCargaEstimados(size_t n) { return n * sizeof(Value); }
+
+    // Métricas estructurales: altura, nodos, llenado, volumen, solapamiento
+    // y espacio muerto por nivel (recorre el árbol completo)
+    EstadisticasArbol estadisticas() const {
+        EstadisticasArbol est;
+        est.capacidad = MAX_ELEMENTOS;
+        est.elementos = rtree_.size();
+        if(rtree_.empty()) return est;
+        VisitanteEstadisticas vis(est);
+        double margen;
+        medir(rtree_.bounds(), vis.log10_volumen_actual, margen);
+        est.niveles.resize(1);
+        est.niveles[0].suma_margen = margen;
+        if(std::isfinite(vis.log10_volumen_actual)) {
+            est.niveles[0].con_volumen = 1;
+            est.niveles[0].suma_log10_volumen = vis.log10_volumen_actual;
+        }
+        Vista(rtree_).apply_visitor(vis);
+        return est;
+    }
+
+    // Nodos internos y hojas que recorre la window query [mins, maxs]
+    VisitaVentana nodosVisitados(const array<double,Dim>& mins, const array<double,Dim>& maxs) const {
+        Point p_min, p_max;
+        fillPoint(p_min, mins);
+        fillPoint(p_max, maxs);
+        Box ventana(p_min, p_max);
+        VisitanteVentana vis(ventana);
+        if(!rtree_.empty()) Vista(rtree_).apply_visitor(vis);
+        return vis.visita;
+    }
+
     // Imprimir estadísticas
     void printStats() const {
+        EstadisticasArbol est = estadisticas();
         cout << "  Estadísticas del R*-tree:" << endl;
         cout << "   Total de elementos: " << total_elements_ << endl;
         cout << "   Dimensiones: " << Dim << "D" << endl;
-        cout << "   Parámetro R*: 16 (max elementos por nodo)" << endl;
+        cout << "   Parámetro R*: " << MAX_ELEMENTOS << " (max elementos por nodo)" << endl;
+        cout << "   Altura: " << est.altura() << ", nodos: " << est.nodos() << " (" << est.hojas() << " hojas)"
+             << ", llenado medio: " << est.llenadoMedio() * 100.0 << "%" << endl;
+        cout << "   Memoria de nodos: " << bytesNodos() / (1024.0 * 1024.0) << " MB" << endl;
     }
 };
 
@@ -0,0 +1,67 @@
+#ifndef BOUNDED_QUEUE_H
+#define BOUNDED_QUEUE_H
+
+#include <deque>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+
+using namespace std;
+
+// Cola productor-consumidor de capacidad fija.
+//  cerrar():   el productor terminó; pop() vacía lo pendiente y luego retorna false
+//  cancelar(): el consumidor ya no quiere más; push() retorna false sin bloquear
+template <typename T>
+class ColaAcotada {
+    deque<T> cola_;
+    size_t capacidad_;
+    mutex mtx_;
+    condition_variable hay_espacio_;
+    condition_variable hay_datos_;
+    bool cerrada_ = false;
+    atomic<bool> cancelada_{false};
+
+public:
+    explicit ColaAcotada(size_t capacidad) : capacidad_(capacidad) {}
+
+    bool push(T item) {
+        unique_lock<mutex> lock(mtx_);
+        hay_espacio_.wait(lock, [this] { return cancelada_ || cola_.size() < capacidad_; });
+        if(cancelada_) return false;
+        cola_.push_back(move(item));
+        lock.unlock();
+        hay_datos_.notify_one();
+        return true;
+    }
+
+    bool pop(T& item) {
+        unique_lock<mutex> lock(mtx_);
+        hay_datos_.wait(lock, [this] { return cerrada_ || !cola_.empty(); });
+        if(cola_.empty()) return false;
+        item = move(cola_.front());
+        cola_.pop_front();
+        lock.unlock();
+        hay_espacio_.notify_one();
+        return true;
+    }
+
+    void cerrar() {
+        {
+            lock_guard<mutex> lock(mtx_);
+            cerrada_ = true;
+        }
+        hay_datos_.notify_all();
+    }
+
+    void cancelar() {
+        {
+            lock_guard<mutex> lock(mtx_);
+            cancelada_ = true;
+        }
+        hay_espacio_.notify_all();
+    }
+
+    bool cancelada() const { return cancelada_.load(memory_order_relaxed); }
+};
+
+#endif // BOUNDED_QUEUE_H
@@ -0,0 +1,107 @@
+#ifndef COORDINATOR_H
+#define COORDINATOR_H
+
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <unistd.h>
+#include "net_protocol.h"
+
+using namespace std;
+
+// Coordinador scatter-gather: envía cada consulta a todos los shards y
+// fusiona sus top-k locales (ids globales) en el top-k global. Cada socket
+// tiene un plazo de recepción: un shard que no responde hace fallar la
+// consulta en vez de colgarla, y su conexión se cierra porque una respuesta
+// tardía desincronizaría las siguientes
+class CoordinadorShards {
+    vector<int> fds_;   // -1 = shard caído
+
+    void cerrarShard(size_t s) {
+        ::close(fds_[s]);
+        fds_[s] = -1;
+    }
+
+public:
+    explicit CoordinadorShards(const vector<string>& rutas_sockets, int plazo_ms = 30000) {
+        for(const string& ruta : rutas_sockets) {
+            fds_.push_back(protocolo::conectarUnix(ruta));
+            protocolo::plazoRecepcion(fds_.back(), plazo_ms);
+        }
+    }
+
+    ~CoordinadorShards() {
+        for(int fd : fds_) {
+            if(fd >= 0) ::close(fd);
+        }
+    }
+
+    CoordinadorShards(const CoordinadorShards&) = delete;
+    CoordinadorShards& operator=(const CoordinadorShards&) = delete;
+
+    // c-ANN distribuido: {id global, distancia} de los k mejores. Si un shard
+    // falla se leen igual las respuestas de los demás y luego se lanza el error
+    vector<pair<int, double>> C_ANN_K(const vector<double>& query, double c, int k) {
+        for(size_t s = 0; s < fds_.size(); s++) {
+            if(fds_[s] < 0) throw runtime_error("Shard " + to_string(s) + " desconectado");
+        }
+
+        // Fan-out: todos los shards procesan la consulta en paralelo
+        vector<char> consulta = protocolo::codificarConsulta(query, c, k);
+        string error;
+        vector<bool> enviada(fds_.size(), false);
+        for(size_t s = 0; s < fds_.size(); s++) {
+            try {
+                protocolo::enviar(fds_[s], protocolo::CONSULTA_KNN, consulta);
+                enviada[s] = true;
+            } catch(const runtime_error& e) {
+                if(error.empty()) error = "Shard " + to_string(s) + ": " + e.what();
+                cerrarShard(s);
+            }
+        }
+
+        // Gather + merge de los top-k locales
+        vector<pair<int, double>> todos;
+        protocolo::Mensaje m;
+        for(size_t s = 0; s < fds_.size(); s++) {
+            if(!enviada[s]) continue;
+            string fallo;
+            try {
+                if(!protocolo::recibir(fds_[s], m)) {
+                    fallo = "conexión cerrada";
+                    cerrarShard(s);
+                } else if(m.tipo == protocolo::ERROR) {
+                    fallo = string(m.datos.begin(), m.datos.end());
+                } else if(m.tipo != protocolo::RESPUESTA_KNN) {
+                    fallo = "respuesta inválida";
+                    cerrarShard(s);
+                } else {
+                    auto parcial = protocolo::decodificarRespuesta(m.datos);
+                    todos.insert(todos.end(), parcial.begin(), parcial.end());
+                }
+            } catch(const runtime_error& e) {
+                fallo = e.what();
+                cerrarShard(s);
+            }
+            if(!fallo.empty() && error.empty()) error = "Shard " + to_string(s) + ": " + fallo;
+        }
+        if(!error.empty()) throw runtime_error(error);
+
+        size_t top = min(static_cast<size_t>(max(k, 0)), todos.size());
+        partial_sort(todos.begin(), todos.begin() + top, todos.end(),
+                     [](const auto& a, const auto& b) { return a.second < b.second; });
+        todos.resize(top);
+        return todos;
+    }
+
+    // Detener todos los shards
+    void detener() {
+        for(int fd : fds_) {
+            if(fd >= 0) protocolo::enviar(fd, protocolo::FIN, {});
+        }
+    }
+
+    size_t numShards() const { return fds_.size(); }
+};
+
+#endif // COORDINATOR_H
@@ -0,0 +1,207 @@
+#ifndef DISK_STORE_H
+#define DISK_STORE_H
+
+#include <vector>
+#include <list>
+#include <string>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <algorithm>
+#include <unordered_map>
+#include <stdexcept>
+#include <cstring>
+#include <cstdint>
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#include "thread_pool.h"
+
+using namespace std;
+
+// Archivo binario de puntos: encabezado de 32 bytes seguido de n filas de D
+// coordenadas contiguas (fila j = punto j), sin relleno entre filas
+//   char     magia[8]   "DBLSHPT1"
+//   uint64_t n
+//   uint32_t D
+//   uint32_t formato    (FormatoPuntos: 0 F64, 1 F32, 2 U8, 3 I8)
+//   uint64_t reservado  0
+struct EncabezadoPuntos {
+    char magia[8];
+    uint64_t n;
+    uint32_t D;
+    uint32_t formato;
+    uint64_t reservado;
+};
+static_assert(sizeof(EncabezadoPuntos) == 32, "Encabezado de 32 bytes");
+
+inline const char* MAGIA_PUNTOS = "DBLSHPT1";
+
+// Lectura de filas de tamaño fijo con pread. Un lote de ids se agrupa en
+// rangos de filas consecutivas y cada rango es un pread; los rangos se
+// reparten en un pool propio de hilos de E/S. Una caché LRU de filas evita
+// releer las calientes. Seguro entre hilos (varias consultas a la vez)
+class ArchivoFilas {
+public:
+    struct Contadores {
+        uint64_t filas = 0;      // Filas pedidas
+        uint64_t aciertos = 0;   // Servidas desde la caché
+        uint64_t lecturas = 0;   // Llamadas a pread
+        uint64_t bytes = 0;      // Bytes leídos del archivo
+    };
+
+private:
+    int fd_ = -1;
+    EncabezadoPuntos enc_;
+    size_t bytes_fila_ = 0;
+    unique_ptr<ThreadPool> pool_;
+
+    // Caché: capacidad_ filas en un único bloque; lru_ guarda ranuras (frente =
+    // más reciente), ranura_[id] la ranura de cada fila cacheada
+    size_t capacidad_ = 0;
+    vector<char> bloque_;
+    list<size_t> lru_;
+    vector<list<size_t>::iterator> posicion_;
+    vector<uint64_t> id_ranura_;
+    unordered_map<uint64_t, size_t> ranura_;
+    mutex mtx_;
+
+    atomic<uint64_t> filas_{0}, aciertos_{0}, lecturas_{0}, bytes_{0};
+
+    void leerRango(uint64_t primera, size_t filas, char* destino) {
+        size_t total = filas * bytes_fila_;
+        off_t offset = static_cast<off_t>(sizeof(EncabezadoPuntos) + primera * bytes_fila_);
+        size_t leidos = 0;
+        while(leidos < total) {
+            ssize_t r = ::pread(fd_, destino + leidos, total - leidos, offset + static_cast<off_t>(leidos));
+            if(r < 0 && errno == EINTR) continue;
+            if(r <= 0) throw runtime_error("pread falló en la fila " + to_string(primera) + ": " + strerror(errno));
+            leidos += static_cast<size_t>(r);
+        }
+        lecturas_++;
+        bytes_ += total;
+    }
+
+    void guardarEnCache(uint64_t id, const char* fila) {
+        if(capacidad_ == 0 || ranura_.count(id)) return;
+        size_t r;
+        if(ranura_.size() < capacidad_) {
+            r = ranura_.size();
+            lru_.push_front(r);
+        } else {
+            r = lru_.back();
+            ranura_.erase(id_ranura_[r]);
+            lru_.splice(lru_.begin(), lru_, posicion_[r]);
+        }
+        posicion_[r] = lru_.begin();
+        id_ranura_[r] = id;
+        ranura_[id] = r;
+        memcpy(&bloque_[r * bytes_fila_], fila, bytes_fila_);
+    }
+
+public:
+    // filas_cache: capacidad de la caché LRU (0 = sin caché); hilos_io: hilos
+    // que leen los rangos de un lote en paralelo (0 = el hilo que pide)
+    ArchivoFilas(const string& ruta, size_t filas_cache, size_t hilos_io) {
+        fd_ = ::open(ruta.c_str(), O_RDONLY);
+        if(fd_ < 0) throw runtime_error("No se pudo abrir " + ruta + ": " + strerror(errno));
+        if(::pread(fd_, &enc_, sizeof(enc_), 0) != static_cast<ssize_t>(sizeof(enc_))
+           || memcmp(enc_.magia, MAGIA_PUNTOS, sizeof(enc_.magia)) != 0) {
+            ::close(fd_);
+            throw runtime_error(ruta + " no es un archivo de puntos DBLSHPT1");
+        }
+        static const size_t bytes_coordenada[] = {8, 4, 1, 1};
+        if(enc_.formato > 3 || enc_.D == 0) {
+            ::close(fd_);
+            throw runtime_error(ruta + ": encabezado inválido");
+        }
+        bytes_fila_ = enc_.D * bytes_coordenada[enc_.formato];
+        off_t esperado = static_cast<off_t>(sizeof(EncabezadoPuntos) + enc_.n * bytes_fila_);
+        if(::lseek(fd_, 0, SEEK_END) < esperado) {
+            ::close(fd_);
+            throw runtime_error(ruta + ": archivo truncado (" + to_string(enc_.n) + " filas declaradas)");
+        }
+        capacidad_ = min<size_t>(filas_cache, enc_.n);
+        bloque_.resize(capacidad_ * bytes_fila_);
+        posicion_.resize(capacidad_);
+        id_ranura_.resize(capacidad_);
+        ranura_.reserve(capacidad_);
+        if(hilos_io > 0) pool_ = make_unique<ThreadPool>(hilos_io);
+    }
+
+    ~ArchivoFilas() {
+        if(fd_ >= 0) ::close(fd_);
+    }
+
+    ArchivoFilas(const ArchivoFilas&) = delete;
+    ArchivoFilas& operator=(const ArchivoFilas&) = delete;
+
+    const EncabezadoPuntos& encabezado() const { return enc_; }
+    size_t bytesFila() const { return bytes_fila_; }
+    size_t bytesCache() const { return bloque_.capacity(); }
+
+    // Copiar las filas ids[0..m) a destino (m × bytesFila())
+    void leer(const int* ids, size_t m, char* destino) {
+        filas_ += m;
+        vector<pair<uint64_t, size_t>> faltantes;   // {id, posición en el lote}
+        {
+            lock_guard<mutex> lock(mtx_);
+            for(size_t j = 0; j < m; j++) {
+                uint64_t id = static_cast<uint64_t>(ids[j]);
+                auto it = ranura_.find(id);
+                if(it == ranura_.end()) {
+                    faltantes.push_back({id, j});
+                    continue;
+                }
+                lru_.splice(lru_.begin(), lru_, posicion_[it->second]);
+                memcpy(destino + j * bytes_fila_, &bloque_[it->second * bytes_fila_], bytes_fila_);
+            }
+        }
+        aciertos_ += m - faltantes.size();
+        if(faltantes.empty()) return;
+
+        // Rangos de ids consecutivos (los repetidos caen en el mismo rango)
+        sort(faltantes.begin(), faltantes.end());
+        vector<size_t> cortes = {0};
+        for(size_t f = 1; f < faltantes.size(); f++) {
+            if(faltantes[f].first > faltantes[f - 1].first + 1) cortes.push_back(f);
+        }
+        cortes.push_back(faltantes.size());
+
+        vector<vector<char>> rangos(cortes.size() - 1);
+        auto leerUno = [&](size_t g) {
+            uint64_t primera = faltantes[cortes[g]].first;
+            size_t filas = faltantes[cortes[g + 1] - 1].first - primera + 1;
+            rangos[g].resize(filas * bytes_fila_);
+            leerRango(primera, filas, rangos[g].data());
+            for(size_t f = cortes[g]; f < cortes[g + 1]; f++) {
+                memcpy(destino + faltantes[f].second * bytes_fila_,
+                       &rangos[g][(faltantes[f].first - primera) * bytes_fila_], bytes_fila_);
+            }
+        };
+        if(pool_ && rangos.size() > 1) pool_->paraCada(rangos.size(), leerUno);
+        else for(size_t g = 0; g < rangos.size(); g++) leerUno(g);
+
+        lock_guard<mutex> lock(mtx_);
+        for(size_t f = 0; f < faltantes.size(); f++) {
+            guardarEnCache(faltantes[f].first, destino + faltantes[f].second * bytes_fila_);
+        }
+    }
+
+    // Filas [primera, primera + filas) sin pasar por la caché (recorridos secuenciales)
+    void leerSecuencial(uint64_t primera, size_t filas, char* destino) {
+        filas_ += filas;
+        leerRango(primera, filas, destino);
+    }
+
+    Contadores contadores() const {
+        Contadores c;
+        c.filas = filas_.load();
+        c.aciertos = aciertos_.load();
+        c.lecturas = lecturas_.load();
+        c.bytes = bytes_.load();
+        return c;
+    }
+};
+
+#endif // DISK_STORE_H
@@ -0,0 +1,123 @@
+#ifndef GENERADOR_H
+#define GENERADOR_H
+
+#include <vector>
+#include <string>
+#include <random>
+#include <cmath>
+#include <algorithm>
+#include <stdexcept>
+#include "point_store.h"
+
+using namespace std;
+
+// Mezcla de gaussianas: `clusters` centros uniformes en [0, rango_centros]^D,
+// cada uno con su escala (desviacion × U[0.5, 1.5]). Con intrinseca > 0 cada
+// cluster varía en un subespacio aleatorio de esa dimensión (covarianza de
+// rango bajo, como los descriptores reales) más ruido isotrópico de
+// desviación `ruido`; con 0 es isotrópico. Cada punto elige un cluster al
+// azar y se recorta a [0, 255]; en formatos enteros se redondea. Con la
+// misma semilla, los primeros m puntos son los mismos para cualquier n ≥ m
+// (los prefijos sirven como datasets más chicos)
+struct ConfigMezcla {
+    size_t n = 0;
+    size_t D = 0;
+    size_t clusters = 100;
+    unsigned semilla = 42;
+    FormatoPuntos formato = FormatoPuntos::F32;
+    double rango_centros = 128.0;
+    double desviacion = 16.0;
+    size_t intrinseca = 0;
+    double ruido = 1.0;
+};
+
+// Presets con la dimensión y el formato de los benchmarks clásicos:
+//  "sift": D = 128, uint8   "gist": D = 960, float
+// Cualquier otro nombre debe ser un entero (D, en float)
+inline ConfigMezcla presetMezcla(const string& nombre, size_t n) {
+    ConfigMezcla cfg;
+    cfg.n = n;
+    if(nombre == "sift") {
+        cfg.D = 128;
+        cfg.formato = FormatoPuntos::U8;
+        cfg.rango_centros = 64.0;
+        cfg.desviacion = 24.0;
+        cfg.intrinseca = 16;
+    } else if(nombre == "gist") {
+        cfg.D = 960;
+        cfg.formato = FormatoPuntos::F32;
+        cfg.rango_centros = 96.0;
+        cfg.desviacion = 24.0;
+        cfg.intrinseca = 32;
+    } else {
+        size_t usados = 0;
+        long D = 0;
+        try { D = stol(nombre, &usados); } catch(const exception&) { usados = 0; }
+        if(usados != nombre.size() || D <= 0) {
+            throw runtime_error("Preset desconocido: " + nombre + " (sift, gist o una dimensión)");
+        }
+        cfg.D = static_cast<size_t>(D);
+    }
+    return cfg;
+}
+
+class GeneradorMezcla {
+    ConfigMezcla cfg_;
+    mt19937_64 gen_;
+    vector<double> centros_;      // clusters × D
+    vector<double> desviaciones_;
+    vector<double> bases_;        // clusters × D × intrinseca (filas = coordenadas)
+    vector<double> latente_;
+    vector<double> punto_;
+    uniform_int_distribution<size_t> elegir_;
+    normal_distribution<double> normal_{0.0, 1.0};
+
+public:
+    explicit GeneradorMezcla(const ConfigMezcla& cfg)
+        : cfg_(cfg), gen_(cfg.semilla), centros_(cfg.clusters * cfg.D),
+          desviaciones_(cfg.clusters), bases_(cfg.clusters * cfg.D * cfg.intrinseca),
+          latente_(cfg.intrinseca), punto_(cfg.D), elegir_(0, cfg.clusters - 1) {
+        if(cfg.D == 0 || cfg.clusters == 0) throw runtime_error("Mezcla: D y clusters deben ser > 0");
+        uniform_real_distribution<double> centro(0.0, cfg.rango_centros);
+        uniform_real_distribution<double> escala(0.5, 1.5);
+        for(double& c : centros_) c = centro(gen_);
+        for(double& s : desviaciones_) s = cfg.desviacion * escala(gen_);
+        // Base con entradas N(0, 1/intrinseca): cada coordenada tiene varianza ~σ²
+        const double norma = cfg.intrinseca ? 1.0 / std::sqrt(static_cast<double>(cfg.intrinseca)) : 0.0;
+        for(double& b : bases_) b = normal_(gen_) * norma;
+    }
+
+    const ConfigMezcla& config() const { return cfg_; }
+
+    // Siguiente punto de la secuencia (válido hasta la próxima llamada)
+    const double* siguiente() {
+        const size_t c = elegir_(gen_);
+        const double* centro = &centros_[c * cfg_.D];
+        const bool entero = cfg_.formato == FormatoPuntos::U8 || cfg_.formato == FormatoPuntos::I8;
+        const size_t m = cfg_.intrinseca;
+        for(size_t j = 0; j < m; j++) latente_[j] = desviaciones_[c] * normal_(gen_);
+        const double* base = m ? &bases_[c * cfg_.D * m] : nullptr;
+        for(size_t d = 0; d < cfg_.D; d++) {
+            double desplazamiento;
+            if(m == 0) {
+                desplazamiento = desviaciones_[c] * normal_(gen_);
+            } else {
+                desplazamiento = cfg_.ruido * normal_(gen_);
+                for(size_t j = 0; j < m; j++) desplazamiento += base[d * m + j] * latente_[j];
+            }
+            double v = clamp(centro[d] + desplazamiento, 0.0, 255.0);
+            // I8 guarda [-128, 127]: se desplaza el rango
+            if(cfg_.formato == FormatoPuntos::I8) v -= 128.0;
+            punto_[d] = entero ? std::round(v) : v;
+        }
+        return punto_.data();
+    }
+};
+
+// Escribir la mezcla completa en el formato binario de disk_store.h
+inline void generarMezcla(const ConfigMezcla& cfg, const string& ruta) {
+    GeneradorMezcla generador(cfg);
+    escribirArchivoPuntos(ruta, cfg.n, cfg.D, cfg.formato, [&](size_t) { return generador.siguiente(); });
+}
+
+#endif // GENERADOR_H
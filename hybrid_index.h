@@ -0,0 +1,218 @@
+#ifndef HYBRID_INDEX_H
+#define HYBRID_INDEX_H
+
+#include <vector>
+#include <array>
+#include <cstdint>
+#include <iostream>
+#include "R_star2.h"
+#include "kernels.h"
+
+using namespace std;
+
+// Índice de dos niveles para proyecciones de Dim dimensiones: un R*-tree sobre
+// las primeras DimArbol coordenadas (donde la poda por MBR todavía funciona)
+// y la proyección completa en un arreglo plano SoA. Cada punto de la ventana
+// del árbol pasa un test de caja SIMD sobre las Dim - DimArbol coordenadas
+// restantes antes de salir, así que las ventanas devuelven exactamente los
+// mismos puntos que un R*-tree de Dim dimensiones (en otro orden).
+//
+// Las ranuras del arreglo siguen el orden de las hojas del árbol y se agrupan
+// en bloques de kernels::FILAS_BLOQUE: dentro de un bloque cada coordenada es
+// una línea de caché con las de sus 8 puntos (SoA por bloque), y las
+// coordenadas consecutivas son líneas consecutivas. Los aciertos de una hoja
+// caen en uno o dos bloques y el test recorre las coordenadas en secuencia
+// hasta que no queda ningún punto vivo. Misma interfaz que RStarTreeIndex<Dim>
+template <size_t Dim, size_t DimArbol>
+class IndiceHibrido {
+    static_assert(DimArbol > 0 && DimArbol < Dim, "El árbol indexa un prefijo propio de las coordenadas");
+    static constexpr size_t B = kernels::FILAS_BLOQUE;
+
+public:
+    // Vista de las Dim coordenadas de un punto dentro de su bloque
+    struct Coordenadas {
+        const double* base = nullptr;
+        double operator[](size_t d) const { return base[d * B]; }
+    };
+    using Value = pair<Coordenadas, int>;   // coordenadas proyectadas e ID
+    using Arbol = RStarTreeIndex<DimArbol>;
+
+private:
+    Arbol arbol_;                 // ID del árbol = ranura en el arreglo
+    vector<double> bloques_;      // ⌈n/B⌉ bloques de Dim × B (coordenada, fila)
+    vector<int> ids_;             // ranura → ID
+    size_t n_ = 0;
+
+    Value valor(size_t ranura) const {
+        return {Coordenadas{&bloques_[(ranura / B) * Dim * B + ranura % B]}, ids_[ranura]};
+    }
+
+    static void prefijo(const array<double, Dim>& a, array<double, DimArbol>& p) {
+        for(size_t d = 0; d < DimArbol; d++) p[d] = a[d];
+    }
+
+    // Acumula los aciertos del árbol por bloque y, al cambiar de bloque, emite
+    // los que pasan el test de caja: emitir(ranura) retorna false para cortar
+    template <typename Emitir>
+    struct Acumulador {
+        const IndiceHibrido& h;
+        const array<double, Dim>& mins;
+        const array<double, Dim>& maxs;
+        Emitir& emitir;
+        size_t bloque = 0;
+        uint32_t mascara = 0;
+
+        bool agregar(size_t ranura) {
+            if(mascara && ranura / B != bloque && !vaciar()) return false;
+            bloque = ranura / B;
+            mascara |= uint32_t(1) << (ranura % B);
+            return true;
+        }
+
+        bool vaciar() {
+            uint32_t vivos = kernels::cajaBloque(&h.bloques_[bloque * Dim * B], DimArbol, Dim,
+                                                 mins.data(), maxs.data(), mascara);
+            mascara = 0;
+            for(; vivos; vivos &= vivos - 1) {
+                if(!emitir(bloque * B + static_cast<size_t>(__builtin_ctz(vivos)))) return false;
+            }
+            return true;
+        }
+    };
+
+public:
+    // ||p - a||² entre un punto del índice y coordenadas proyectadas
+    static double distancia2(const Coordenadas& p, const array<double, Dim>& a) {
+        double s = 0.0;
+        for(size_t d = 0; d < Dim; d++) {
+            double diff = p[d] - a[d];
+            s += diff * diff;
+        }
+        return s;
+    }
+
+    // generar(j, coords) escribe las Dim coordenadas del elemento j y retorna
+    // su ID: su prefijo va al buffer de carga del árbol y las coordenadas a un
+    // arreglo por filas que, una vez renumeradas las hojas, se reparte en los
+    // bloques (transitorio de n × Dim doubles, como el buffer de carga)
+    template <typename F>
+    void bulkLoadGenerado(size_t n, F generar) {
+        TRACE_SCOPE("bulkLoad híbrido");
+        n_ = n;
+        vector<double> filas(n * Dim);
+        vector<int> ids_entrada(n);
+        array<double, Dim> coords;
+        arbol_.bulkLoadGenerado(n, [&](size_t j, array<double, DimArbol>& clave) {
+            ids_entrada[j] = generar(j, coords);
+            copy(coords.begin(), coords.end(), &filas[j * Dim]);
+            prefijo(coords, clave);
+            return static_cast<int>(j);
+        });
+
+        // Ranura r = r-ésimo punto en el orden de las hojas
+        size_t ranura = 0;
+        ids_.resize(n);
+        bloques_.assign((n + B - 1) / B * Dim * B, 0.0);
+        arbol_.renumerarHojas([&](int j) {
+            ids_[ranura] = ids_entrada[j];
+            double* destino = &bloques_[(ranura / B) * Dim * B + ranura % B];
+            for(size_t d = 0; d < Dim; d++) destino[d * B] = filas[static_cast<size_t>(j) * Dim + d];
+            return static_cast<int>(ranura++);
+        });
+    }
+
+    template <typename Contenedor>
+    void bulkLoad(const Contenedor& data) {
+        auto it = data.begin();
+        bulkLoadGenerado(data.size(), [&](size_t, array<double, Dim>& coords) {
+            coords = it->first;
+            return (it++)->second;
+        });
+    }
+
+    vector<Value> windowQuery(const array<double, Dim>& mins, const array<double, Dim>& maxs) const {
+        vector<Value> result;
+        windowQuery(mins, maxs, [&](const Value& v) { result.push_back(v); });
+        return result;
+    }
+
+    template <typename F>
+    void windowQuery(const array<double, Dim>& mins, const array<double, Dim>& maxs, F visitar) const {
+        TRACE_SCOPE("windowQuery híbrida");
+        array<double, DimArbol> mins_arbol, maxs_arbol;
+        prefijo(mins, mins_arbol);
+        prefijo(maxs, maxs_arbol);
+        auto emitir = [&](size_t ranura) {
+            visitar(valor(ranura));
+            return true;
+        };
+        Acumulador<decltype(emitir)> acc{*this, mins, maxs, emitir};
+        arbol_.windowQuery(mins_arbol, maxs_arbol, [&](const typename Arbol::Value& v) {
+            acc.agregar(static_cast<size_t>(v.second));
+        });
+        if(acc.mascara) acc.vaciar();
+    }
+
+    // Incremental: visitar(value) retorna false para abandonar el recorrido.
+    // Retorna true si se recorrió completa
+    template <typename F>
+    bool windowQueryHasta(const array<double, Dim>& mins, const array<double, Dim>& maxs, F visitar) const {
+        TRACE_SCOPE("windowQuery híbrida incremental");
+        array<double, DimArbol> mins_arbol, maxs_arbol;
+        prefijo(mins, mins_arbol);
+        prefijo(maxs, maxs_arbol);
+        auto emitir = [&](size_t ranura) { return visitar(valor(ranura)); };
+        Acumulador<decltype(emitir)> acc{*this, mins, maxs, emitir};
+        bool completa = arbol_.windowQueryHasta(mins_arbol, maxs_arbol, [&](const typename Arbol::Value& v) {
+            return acc.agregar(static_cast<size_t>(v.second));
+        });
+        return completa && (!acc.mascara || acc.vaciar());
+    }
+
+    void clear() {
+        arbol_.clear();
+        vector<double>().swap(bloques_);
+        vector<int>().swap(ids_);
+        n_ = 0;
+    }
+
+    // Nodos del árbol más bloques e IDs
+    size_t bytesNodos() const {
+        return arbol_.bytesNodos() + bloques_.capacity() * sizeof(double) + ids_.capacity() * sizeof(int);
+    }
+
+    size_t bytesPico() const {
+        return arbol_.bytesPico() + bloques_.capacity() * sizeof(double) + ids_.capacity() * sizeof(int);
+    }
+
+    static size_t bytesEstimados(size_t n) {
+        return Arbol::bytesEstimados(n) + n * (Dim * sizeof(double) + sizeof(int));
+    }
+
+    static size_t bytesCargaEstimados(size_t n) {
+        return Arbol::bytesCargaEstimados(n) + n * (Dim * sizeof(double) + sizeof(int));
+    }
+
+    // Métricas del árbol de DimArbol dimensiones
+    EstadisticasArbol estadisticas() const { return arbol_.estadisticas(); }
+
+    // Nodos que recorre la ventana en el árbol; puntos = los que además pasan
+    // el test de las coordenadas restantes
+    VisitaVentana nodosVisitados(const array<double, Dim>& mins, const array<double, Dim>& maxs) const {
+        array<double, DimArbol> mins_arbol, maxs_arbol;
+        prefijo(mins, mins_arbol);
+        prefijo(maxs, maxs_arbol);
+        VisitaVentana v = arbol_.nodosVisitados(mins_arbol, maxs_arbol);
+        v.puntos = 0;
+        windowQuery(mins, maxs, [&](const Value&) { v.puntos++; });
+        return v;
+    }
+
+    void printStats() const {
+        cout << "  Índice híbrido: R*-tree de " << DimArbol << "D + filtro SoA de " << Dim - DimArbol
+             << " coordenadas (" << bloques_.capacity() * sizeof(double) / (1024.0 * 1024.0) << " MB)" << endl;
+        arbol_.printStats();
+    }
+};
+
+#endif // HYBRID_INDEX_H
@@ -0,0 +1,219 @@
+#ifndef KERNELS_H
+#define KERNELS_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cmath>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+// Kernels de distancia L2 al cuadrado sobre filas contiguas.
+// Las versiones enteras son exactas: la diferencia se ensancha a int16 y el
+// producto-suma (vpmaddwd / vpdpwssd) acumula en int32, vaciando a int64 por
+// bloques para que no haya desbordamiento con D grande.
+//
+// Todos reciben la longitud como parámetro de plantilla N (> 0: fija en
+// compilación, el compilador desenrolla y vectoriza sin epílogo variable) o
+// en ejecución (N = 0, argumento D). Los de punto flotante acumulan en
+// CARRILES sumas independientes: el orden de suma es el mismo en ambos casos,
+// así que la versión fija y la de ejecución dan resultados idénticos.
+namespace kernels {
+
+// Elementos por bloque antes de vaciar el acumulador int32 a int64
+// (cada par aporta como máximo 2 * 255^2 = 130050)
+constexpr size_t BLOQUE_ENTERO = 8192;
+
+// Sumas parciales independientes de los kernels double (un vector AVX-512 o dos AVX2)
+constexpr size_t CARRILES = 8;
+
+// Alineación de las filas de la matriz de proyección gaussiana
+constexpr size_t ALINEACION = 64;
+
+inline double sumarCarriles(const double* s) {
+    return ((s[0] + s[4]) + (s[1] + s[5])) + ((s[2] + s[6]) + (s[3] + s[7]));
+}
+
+// Σ (q[i] - p[i])² con p de cualquier tipo numérico
+template <size_t N, typename T>
+inline double l2sq_carriles(const double* q, const T* p, size_t D) {
+    const size_t n = N ? N : D;
+    const size_t n_carriles = n - n % CARRILES;
+    double s[CARRILES] = {};
+    for(size_t i = 0; i < n_carriles; i += CARRILES) {
+        for(size_t l = 0; l < CARRILES; l++) {
+            double diff = q[i + l] - static_cast<double>(p[i + l]);
+            s[l] += diff * diff;
+        }
+    }
+    double sum = sumarCarriles(s);
+    for(size_t i = n_carriles; i < n; i++) {
+        double diff = q[i] - static_cast<double>(p[i]);
+        sum += diff * diff;
+    }
+    return sum;
+}
+
+template <size_t N = 0>
+inline double l2sq_f64(const double* a, const double* b, size_t D = N) {
+    return l2sq_carriles<N>(a, b, D);
+}
+
+// Query en double contra fila uint8 (queries no enteras en modo compacto)
+template <size_t N = 0>
+inline double l2sq_f64_u8(const double* q, const uint8_t* p, size_t D = N) {
+    return l2sq_carriles<N>(q, p, D);
+}
+
+template <size_t N = 0>
+inline double l2sq_f64_f32(const double* q, const float* p, size_t D = N) {
+    return l2sq_carriles<N>(q, p, D);
+}
+
+template <size_t N = 0>
+inline double l2sq_f64_i8(const double* q, const int8_t* p, size_t D = N) {
+    return l2sq_carriles<N>(q, p, D);
+}
+
+// Producto punto fila · p, con la fila alineada a ALINEACION bytes
+template <size_t N = 0>
+inline double dot_f64(const double* fila, const double* p, size_t D = N) {
+    const double* f = static_cast<const double*>(__builtin_assume_aligned(fila, ALINEACION));
+    const size_t n = N ? N : D;
+    const size_t n_carriles = n - n % CARRILES;
+    double s[CARRILES] = {};
+    for(size_t i = 0; i < n_carriles; i += CARRILES) {
+        for(size_t l = 0; l < CARRILES; l++) s[l] += f[i + l] * p[i + l];
+    }
+    double sum = sumarCarriles(s);
+    for(size_t i = n_carriles; i < n; i++) sum += f[i] * p[i];
+    return sum;
+}
+
+#if defined(__AVX2__)
+// Suma horizontal de 8 int32
+inline int64_t hsum_epi32(__m256i v) {
+    __m128i s = _mm_add_epi32(_mm256_castsi256_si128(v), _mm256_extracti128_si256(v, 1));
+    s = _mm_add_epi32(s, _mm_shuffle_epi32(s, _MM_SHUFFLE(1, 0, 3, 2)));
+    s = _mm_add_epi32(s, _mm_shuffle_epi32(s, _MM_SHUFFLE(2, 3, 0, 1)));
+    return static_cast<int64_t>(_mm_cvtsi128_si32(s));
+}
+
+// acc += d·d por pares de int16 (VNNI si está disponible)
+inline __m256i madd_acc(__m256i acc, __m256i d) {
+#if defined(__AVX512VNNI__) && defined(__AVX512VL__)
+    return _mm256_dpwssd_epi32(acc, d, d);
+#else
+    return _mm256_add_epi32(acc, _mm256_madd_epi16(d, d));
+#endif
+}
+#endif
+
+// Distancia exacta uint8 vs uint8
+template <size_t N = 0>
+inline int64_t l2sq_u8(const uint8_t* a, const uint8_t* b, size_t D = N) {
+    if(N) D = N;
+    int64_t total = 0;
+    size_t i = 0;
+#if defined(__AVX2__)
+    while(i + 32 <= D) {
+        size_t fin = i + BLOQUE_ENTERO < D ? i + BLOQUE_ENTERO : D;
+        __m256i acc = _mm256_setzero_si256();
+        for(; i + 32 <= fin; i += 32) {
+            __m256i va = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i));
+            __m256i vb = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + i));
+            __m256i d_lo = _mm256_sub_epi16(_mm256_cvtepu8_epi16(_mm256_castsi256_si128(va)),
+                                            _mm256_cvtepu8_epi16(_mm256_castsi256_si128(vb)));
+            __m256i d_hi = _mm256_sub_epi16(_mm256_cvtepu8_epi16(_mm256_extracti128_si256(va, 1)),
+                                            _mm256_cvtepu8_epi16(_mm256_extracti128_si256(vb, 1)));
+            acc = madd_acc(acc, d_lo);
+            acc = madd_acc(acc, d_hi);
+        }
+        total += hsum_epi32(acc);
+    }
+#endif
+    for(; i < D; i++) {
+        int32_t diff = static_cast<int32_t>(a[i]) - static_cast<int32_t>(b[i]);
+        total += diff * diff;
+    }
+    return total;
+}
+
+// Distancia exacta int8 vs int8
+template <size_t N = 0>
+inline int64_t l2sq_i8(const int8_t* a, const int8_t* b, size_t D = N) {
+    if(N) D = N;
+    int64_t total = 0;
+    size_t i = 0;
+#if defined(__AVX2__)
+    while(i + 32 <= D) {
+        size_t fin = i + BLOQUE_ENTERO < D ? i + BLOQUE_ENTERO : D;
+        __m256i acc = _mm256_setzero_si256();
+        for(; i + 32 <= fin; i += 32) {
+            __m256i va = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i));
+            __m256i vb = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + i));
+            __m256i d_lo = _mm256_sub_epi16(_mm256_cvtepi8_epi16(_mm256_castsi256_si128(va)),
+                                            _mm256_cvtepi8_epi16(_mm256_castsi256_si128(vb)));
+            __m256i d_hi = _mm256_sub_epi16(_mm256_cvtepi8_epi16(_mm256_extracti128_si256(va, 1)),
+                                            _mm256_cvtepi8_epi16(_mm256_extracti128_si256(vb, 1)));
+            acc = madd_acc(acc, d_lo);
+            acc = madd_acc(acc, d_hi);
+        }
+        total += hsum_epi32(acc);
+    }
+#endif
+    for(; i < D; i++) {
+        int32_t diff = static_cast<int32_t>(a[i]) - static_cast<int32_t>(b[i]);
+        total += diff * diff;
+    }
+    return total;
+}
+
+// Filas por bloque de los arreglos SoA del índice híbrido y de la proyección
+// plana del planificador (una línea de caché de doubles)
+constexpr size_t FILAS_BLOQUE = 8;
+
+// Test de caja de las filas vivas (bits de `vivos`) de un bloque SoA: bloque
+// tiene FILAS_BLOQUE valores contiguos por coordenada. Recorre las
+// coordenadas [desde, hasta) y apaga las filas con lo[d] ≤ x ≤ hi[d] falso;
+// corta en cuanto no queda ninguna. Retorna la máscara de las que pasan
+inline uint32_t cajaBloque(const double* bloque, size_t desde, size_t hasta, const double* lo, const double* hi,
+                           uint32_t vivos) {
+    for(size_t d = desde; d < hasta && vivos; d++) {
+        const double* x = bloque + d * FILAS_BLOQUE;
+#if defined(__AVX2__)
+        __m256d vlo = _mm256_broadcast_sd(lo + d);
+        __m256d vhi = _mm256_broadcast_sd(hi + d);
+        __m256d a = _mm256_loadu_pd(x);
+        __m256d b = _mm256_loadu_pd(x + 4);
+        int dentro_a = _mm256_movemask_pd(_mm256_and_pd(_mm256_cmp_pd(a, vlo, _CMP_GE_OQ), _mm256_cmp_pd(a, vhi, _CMP_LE_OQ)));
+        int dentro_b = _mm256_movemask_pd(_mm256_and_pd(_mm256_cmp_pd(b, vlo, _CMP_GE_OQ), _mm256_cmp_pd(b, vhi, _CMP_LE_OQ)));
+        vivos &= static_cast<uint32_t>(dentro_a | (dentro_b << 4));
+#else
+        uint32_t dentro = 0;
+        for(size_t f = 0; f < FILAS_BLOQUE; f++) dentro |= uint32_t(x[f] >= lo[d] && x[f] <= hi[d]) << f;
+        vivos &= dentro;
+#endif
+    }
+    return vivos;
+}
+
+// Transformada rápida de Walsh-Hadamard in-place (sin normalizar), n potencia de 2.
+// O(n log n) sumas/restas en lugar del producto matriz-vector O(n²)
+inline void fwht(double* v, size_t n) {
+    for(size_t h = 1; h < n; h <<= 1) {
+        for(size_t i = 0; i < n; i += h << 1) {
+            for(size_t j = i; j < i + h; j++) {
+                double x = v[j];
+                double y = v[j + h];
+                v[j] = x + y;
+                v[j + h] = x - y;
+            }
+        }
+    }
+}
+
+} // namespace kernels
+
+#endif // KERNELS_H
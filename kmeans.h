@@ -0,0 +1,75 @@
+#ifndef KMEANS_H
+#define KMEANS_H
+
+#include <vector>
+#include <random>
+#include <limits>
+#include <algorithm>
+
+using namespace std;
+
+// k-means de Lloyd sobre n vectores de dimensión dim (fila-mayor, float).
+// Inicialización con k puntos distintos al azar; los clusters vacíos se
+// re-siembran con un punto aleatorio. Retorna k×dim centroides.
+inline vector<float> kmeansLloyd(const vector<float>& puntos, size_t n, size_t dim,
+                                 size_t k, int iteraciones, mt19937& gen,
+                                 vector<int>* asignacion_out = nullptr) {
+    vector<float> centroides(k * dim, 0.0f);
+    if(n == 0) return centroides;
+
+    vector<size_t> orden(n);
+    for(size_t i = 0; i < n; i++) orden[i] = i;
+    shuffle(orden.begin(), orden.end(), gen);
+    for(size_t c = 0; c < k; c++) {
+        const float* p = &puntos[orden[c % n] * dim];
+        copy(p, p + dim, &centroides[c * dim]);
+    }
+
+    vector<int> asignacion(n, 0);
+    vector<double> suma(k * dim);
+    vector<size_t> cuenta(k);
+    uniform_int_distribution<size_t> azar(0, n - 1);
+
+    for(int it = 0; it < iteraciones; it++) {
+        // Asignación: centroide más cercano
+        for(size_t i = 0; i < n; i++) {
+            const float* p = &puntos[i * dim];
+            float mejor = numeric_limits<float>::max();
+            int mejor_c = 0;
+            for(size_t c = 0; c < k; c++) {
+                const float* q = &centroides[c * dim];
+                float d2 = 0.0f;
+                for(size_t d = 0; d < dim; d++) {
+                    float diff = p[d] - q[d];
+                    d2 += diff * diff;
+                }
+                if(d2 < mejor) { mejor = d2; mejor_c = static_cast<int>(c); }
+            }
+            asignacion[i] = mejor_c;
+        }
+
+        // Actualización: media de cada cluster
+        fill(suma.begin(), suma.end(), 0.0);
+        fill(cuenta.begin(), cuenta.end(), 0);
+        for(size_t i = 0; i < n; i++) {
+            size_t c = asignacion[i];
+            cuenta[c]++;
+            for(size_t d = 0; d < dim; d++) suma[c * dim + d] += puntos[i * dim + d];
+        }
+        for(size_t c = 0; c < k; c++) {
+            if(cuenta[c] == 0) {
+                const float* p = &puntos[azar(gen) * dim];
+                copy(p, p + dim, &centroides[c * dim]);
+                continue;
+            }
+            for(size_t d = 0; d < dim; d++) {
+                centroides[c * dim + d] = static_cast<float>(suma[c * dim + d] / cuenta[c]);
+            }
+        }
+    }
+
+    if(asignacion_out) *asignacion_out = move(asignacion);
+    return centroides;
+}
+
+#endif // KMEANS_H
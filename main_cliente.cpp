@@ -0,0 +1,163 @@
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include "net_protocol.h"
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <random>
+#include <algorithm>
+#include <exception>
+
+using namespace std;
+using namespace std::chrono;
+
+vector<vector<double>> loadDataset(const string& path, size_t max_rows = 5000) {
+    ifstream f(path);
+    if (!f) throw runtime_error("No se pudo abrir " + path);
+
+    string line;
+    getline(f, line);
+    vector<vector<double>> datos;
+    datos.reserve(max_rows);
+
+    while (getline(f, line) && datos.size() < max_rows) {
+        stringstream ss(line);
+        string cell;
+        if (!getline(ss, cell, ',')) continue;
+
+        vector<double> row;
+        row.reserve(784);
+        while (getline(ss, cell, ',')) {
+            row.push_back(stod(cell));
+        }
+        if (row.size() == 784) datos.push_back(move(row));
+    }
+    return datos;
+}
+
+#define MAIN_C 1.5
+#define CLIENTE_HILOS 8          // Conexiones concurrentes
+#define CLIENTE_CONSULTAS 400    // Consultas totales
+#define CLIENTE_K 50
+#define CLIENTE_LOTE_INSERCION 100  // Puntos por mensaje con --insertar
+#define CLIENTE_PAUSA_INSERCION_MS 250  // Pausa entre mensajes de inserción
+
+// Cliente de carga para main_server: envía consultas desde varias conexiones
+// concurrentes (para que el servidor forme micro-lotes) y muestra sus contadores.
+// Con --insertar, otra conexión inserta lotes de puntos mientras duran las consultas.
+// Uso: main_cliente [unix:/ruta | tcp:puerto] [dataset] [--insertar] [--detener]
+int main(int argc, char** argv){
+    string direccion = argc > 1 ? argv[1] : "unix:/tmp/dblsh_server.sock";
+    string dataset = argc > 2 ? argv[2] : "fashion_mnist.csv";
+    bool detener = false, insertar = false;
+    for(int i = 3; i < argc; i++) {
+        if(string(argv[i]) == "--detener") detener = true;
+        if(string(argv[i]) == "--insertar") insertar = true;
+    }
+
+    vector<vector<double>> queries = loadDataset(dataset, 1000);
+    mt19937 gen(7);
+    shuffle(queries.begin(), queries.end(), gen);
+
+    atomic<int> siguiente(0);
+    vector<double> latencias_ms(CLIENTE_CONSULTAS, 0.0);
+    auto inicio = steady_clock::now();
+
+    atomic<bool> consultando(true);
+    size_t insertados = 0;
+    exception_ptr error_insercion;   // Se informa tras el join
+    thread hilo_insercion;
+    if(insertar) {
+        hilo_insercion = thread([&] {
+            int fd = -1;
+            try {
+                fd = protocolo::conectar(direccion);
+                protocolo::Mensaje m;
+                size_t pos = 0;
+                while(consultando) {
+                    vector<vector<double>> lote;
+                    for(int i = 0; i < CLIENTE_LOTE_INSERCION; i++) lote.push_back(queries[pos++ % queries.size()]);
+                    protocolo::enviar(fd, protocolo::INSERTAR, protocolo::codificarInsercion(lote));
+                    if(!protocolo::recibir(fd, m)) throw runtime_error("El servidor cerró la conexión");
+                    if(m.tipo == protocolo::ERROR) throw runtime_error("Servidor: " + string(m.datos.begin(), m.datos.end()));
+                    if(m.tipo != protocolo::INSERTAR) throw runtime_error("Respuesta inválida del servidor");
+                    insertados += lote.size();
+                    this_thread::sleep_for(milliseconds(CLIENTE_PAUSA_INSERCION_MS));
+                }
+            } catch(...) {
+                error_insercion = current_exception();
+            }
+            if(fd >= 0) ::close(fd);
+        });
+    }
+
+    // Un error en un hilo se guarda y se informa tras el join (una excepción
+    // que escapa de un std::thread termina el proceso)
+    vector<exception_ptr> errores(CLIENTE_HILOS);
+    vector<thread> hilos;
+    for(int h = 0; h < CLIENTE_HILOS; h++) {
+        hilos.emplace_back([&, h] {
+            int fd = -1;
+            try {
+                fd = protocolo::conectar(direccion);
+                protocolo::Mensaje m;
+                for(int i = siguiente++; i < CLIENTE_CONSULTAS; i = siguiente++) {
+                    const auto& q = queries[i % queries.size()];
+                    auto t0 = steady_clock::now();
+                    protocolo::enviar(fd, protocolo::CONSULTA_KNN, protocolo::codificarConsulta(q, MAIN_C, CLIENTE_K));
+                    if(!protocolo::recibir(fd, m)) throw runtime_error("El servidor cerró la conexión");
+                    if(m.tipo == protocolo::ERROR) throw runtime_error("Servidor: " + string(m.datos.begin(), m.datos.end()));
+                    if(m.tipo != protocolo::RESPUESTA_KNN) throw runtime_error("Respuesta inválida del servidor");
+                    latencias_ms[i] = duration<double, milli>(steady_clock::now() - t0).count();
+                }
+            } catch(...) {
+                errores[h] = current_exception();
+                siguiente = CLIENTE_CONSULTAS;   // Los demás hilos dejan de tomar consultas
+            }
+            if(fd >= 0) ::close(fd);
+        });
+    }
+    for(auto& h : hilos) h.join();
+    double total_s = duration<double>(steady_clock::now() - inicio).count();
+    consultando = false;
+    if(hilo_insercion.joinable()) hilo_insercion.join();
+    bool fallo = false;
+    for(auto& e : errores) {
+        if(!e) continue;
+        try { rethrow_exception(e); } catch(const exception& ex) { cerr << "Consulta: " << ex.what() << endl; }
+        fallo = true;
+    }
+    if(error_insercion) {
+        try { rethrow_exception(error_insercion); } catch(const exception& ex) { cerr << "Inserción: " << ex.what() << endl; }
+        fallo = true;
+    }
+    if(fallo) return 1;
+
+    sort(latencias_ms.begin(), latencias_ms.end());
+    cout << "Consultas: " << CLIENTE_CONSULTAS << " desde " << CLIENTE_HILOS << " conexiones" << endl;
+    cout << "  QPS: " << CLIENTE_CONSULTAS / total_s << endl;
+    cout << "  Latencia cliente: p50 " << latencias_ms[CLIENTE_CONSULTAS / 2] << " ms, p99 "
+         << latencias_ms[CLIENTE_CONSULTAS * 99 / 100] << " ms" << endl;
+    if(insertar) cout << "  Puntos insertados durante las consultas: " << insertados << endl;
+
+    int fd = protocolo::conectar(direccion);
+    protocolo::enviar(fd, protocolo::ESTADISTICAS, {});
+    protocolo::Mensaje m;
+    if(protocolo::recibir(fd, m) && m.tipo == protocolo::ESTADISTICAS) {
+        auto st = protocolo::decodificarEstadisticas(m.datos);
+        cout << "Servidor:" << endl;
+        cout << "  Peticiones: " << st.peticiones << " en " << st.lotes << " lotes (media "
+             << st.lote_medio << " por lote)" << endl;
+        cout << "  Cola: actual " << st.cola_actual << ", máxima " << st.cola_maxima << endl;
+        cout << "  Latencia servidor: media " << st.latencia_media_us << " us, p50 "
+             << st.latencia_p50_us << " us, p99 " << st.latencia_p99_us << " us" << endl;
+        cout << "  Respuestas parciales (plazo vencido): " << st.parciales << endl;
+        cout << "  Índice: versión " << st.version << ", " << st.puntos << " puntos ("
+             << st.puntos_delta << " sin publicar)" << endl;
+    }
+    if(detener) protocolo::enviar(fd, protocolo::FIN, {});
+    ::close(fd);
+    return 0;
+}
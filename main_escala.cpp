@@ -0,0 +1,117 @@
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <set>
+#include <filesystem>
+#include <chrono>
+#include "DBLSH.h"
+
+using namespace std;
+using namespace std::chrono;
+
+#define ESCALA_C 1.5
+#define ESCALA_t 500
+#define ESCALA_K 12
+#define ESCALA_L 5
+#define ESCALA_KNN 10
+#define ESCALA_QUERIES 100        // Últimas filas del archivo (no se indexan)
+#define ESCALA_N_MIN (1 << 14)    // Primer n; se duplica hasta agotar el archivo
+#define ESCALA_MUESTRA_RADIOS 256
+
+// Benchmark de escalabilidad sobre un archivo de puntos (main_generador):
+// para n = N_MIN, 2·N_MIN, ... se indexan las primeras n filas en memoria y
+// se miden construcción, memoria, QPS y recall@k contra fuerza bruta
+//   ./bin/main_escala <archivo> [queries] [n_max]
+int main(int argc, char** argv) {
+    if(argc < 2) {
+        cerr << "Uso: " << argv[0] << " <archivo> [queries] [n_max]" << endl;
+        return 1;
+    }
+    const string ruta = argv[1];
+    const size_t num_queries = argc > 2 ? stoull(argv[2]) : ESCALA_QUERIES;
+    std::filesystem::create_directories("results");
+
+    // Queries: las últimas filas del archivo, fuera de todos los prefijos
+    ArchivoFilas archivo(ruta, 0, 0);
+    const EncabezadoPuntos enc = archivo.encabezado();
+    const FormatoPuntos formato = static_cast<FormatoPuntos>(enc.formato);
+    const int D = static_cast<int>(enc.D);
+    if(enc.n <= num_queries) {
+        cerr << ruta << " tiene " << enc.n << " filas, se necesitan más de " << num_queries << endl;
+        return 1;
+    }
+    size_t n_max = enc.n - num_queries;
+    if(argc > 3) n_max = min<size_t>(n_max, stoull(argv[3]));
+
+    vector<vector<double>> queries(num_queries, vector<double>(D));
+    vector<char> crudo(num_queries * archivo.bytesFila());
+    archivo.leerSecuencial(enc.n - num_queries, num_queries, crudo.data());
+    for(size_t i = 0; i < num_queries; i++) {
+        filaADouble(formato, &crudo[i * archivo.bytesFila()], D, queries[i].data());
+    }
+
+    cout << "============================================================" << endl;
+    cout << "DB-LSH: Escalabilidad (" << ruta << ")" << endl;
+    cout << "============================================================" << endl;
+    cout << "D = " << D << " (" << nombreFormato(formato) << "), queries: " << num_queries
+         << ", n hasta " << n_max << endl;
+    cout << "K = " << ESCALA_K << ", L = " << ESCALA_L << ", C = " << ESCALA_C << ", t = " << ESCALA_t
+         << ", k = " << ESCALA_KNN << endl;
+
+    const string salida = "results/scaling_results.csv";
+    ofstream csv_file(salida);
+    csv_file << "n,construccion_s,residente_mb,arboles_mb,pico_mb,qps,recall,ratio,verificados,rondas\n";
+
+    cout << "\nn\t\tconstr (s)\tresid (MB)\tQPS\t\trecall\tratio" << endl;
+    auto mb = [](size_t b) { return b / (1024.0 * 1024.0); };
+    for(size_t n = min<size_t>(ESCALA_N_MIN, n_max); ; n = min(2 * n, n_max)) {
+        DBLSH<ESCALA_K> indice(D, ESCALA_L, ESCALA_C, 1, ESCALA_t, 42, FamiliaHash::GAUSSIANA, false);
+        indice.configurarRadioAprendido(ESCALA_MUESTRA_RADIOS);
+
+        auto inicio = high_resolution_clock::now();
+        indice.cargarArchivo(ruta, n);
+        double construccion_s = duration<double>(high_resolution_clock::now() - inicio).count();
+        ReporteMemoria memoria = indice.reporteMemoria();
+
+        vector<vector<tuple<int, vector<double>, double>>> respuestas(num_queries);
+        EstadisticasConsulta st;
+        inicio = high_resolution_clock::now();
+        for(size_t i = 0; i < num_queries; i++) {
+            respuestas[i] = indice.C_ANN_K(queries[i], ESCALA_C, ESCALA_KNN, &st);
+        }
+        double consulta_s = duration<double>(high_resolution_clock::now() - inicio).count();
+
+        double recall = 0.0, ratio = 0.0;
+        for(size_t i = 0; i < num_queries; i++) {
+            auto reales = indice.encontrarKVecinosReales(queries[i], ESCALA_KNN);
+            set<int> ids_reales;
+            for(const auto& [id, dist] : reales) ids_reales.insert(id);
+            size_t aciertos = 0;
+            double suma_ratio = 0.0;
+            for(size_t j = 0; j < respuestas[i].size(); j++) {
+                if(ids_reales.count(get<0>(respuestas[i][j]))) aciertos++;
+                if(j < reales.size()) {
+                    suma_ratio += reales[j].second > 1e-9 ? get<2>(respuestas[i][j]) / reales[j].second : 1.0;
+                }
+            }
+            recall += static_cast<double>(aciertos) / reales.size();
+            ratio += respuestas[i].empty() ? 0.0 : suma_ratio / min(respuestas[i].size(), reales.size());
+        }
+        recall /= num_queries;
+        ratio /= num_queries;
+        double qps = num_queries / consulta_s;
+
+        cout << n << "\t\t" << construccion_s << "\t\t" << mb(memoria.residente()) << "\t\t"
+             << qps << "\t\t" << recall << "\t" << ratio << endl;
+        csv_file << n << "," << construccion_s << "," << mb(memoria.residente()) << ","
+                 << mb(memoria.arboles) << "," << mb(memoria.pico()) << "," << qps << ","
+                 << recall << "," << ratio << "," << st.verificados / static_cast<double>(num_queries) << ","
+                 << st.rondas / static_cast<double>(num_queries) << "\n";
+        csv_file.flush();
+        if(n == n_max) break;
+    }
+    csv_file.close();
+    cout << "\n[Resultados guardados en " << salida << "]" << endl;
+    return 0;
+}
@@ -0,0 +1,36 @@
+#include <iostream>
+#include <string>
+#include <filesystem>
+#include <chrono>
+#include "generador.h"
+
+using namespace std;
+using namespace std::chrono;
+
+// Generador de datasets sintéticos en el formato binario de disk_store.h
+//   ./bin/main_generador <sift|gist|D> <n> <salida> [clusters] [semilla]
+int main(int argc, char** argv) {
+    if(argc < 4) {
+        cerr << "Uso: " << argv[0] << " <sift|gist|D> <n> <salida> [clusters] [semilla]" << endl;
+        return 1;
+    }
+    try {
+        ConfigMezcla cfg = presetMezcla(argv[1], stoull(argv[2]));
+        if(argc > 4) cfg.clusters = stoull(argv[4]);
+        if(argc > 5) cfg.semilla = static_cast<unsigned>(stoul(argv[5]));
+        const string salida = argv[3];
+        filesystem::path padre = filesystem::path(salida).parent_path();
+        if(!padre.empty()) filesystem::create_directories(padre);
+
+        cout << "Generando " << cfg.n << " puntos D = " << cfg.D << " (" << nombreFormato(cfg.formato)
+             << ", " << cfg.clusters << " clusters, semilla " << cfg.semilla << ") en " << salida << endl;
+        auto inicio = high_resolution_clock::now();
+        generarMezcla(cfg, salida);
+        double s = duration<double>(high_resolution_clock::now() - inicio).count();
+        cout << "Listo en " << s << " s (" << filesystem::file_size(salida) / (1024.0 * 1024.0) << " MB)" << endl;
+    } catch(const exception& e) {
+        cerr << "Error: " << e.what() << endl;
+        return 1;
+    }
+    return 0;
+}
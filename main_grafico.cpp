@@ -1,7 +1,8 @@
 #include <iostream>
 #include <fstream>
 #include <sstream>
-#include "R_star2.h"
+#include "DBLSH.h"
+#include "perf_counters.h"
 #include <vector>
 #include <tuple>
 #include <cmath>
@@ -14,196 +15,8 @@
 using namespace std;
 using namespace std::chrono;
 
-// Clase DB-LSH (copiada de main_k.cpp)
-template <size_t K>
-class DBLSH {
-    private:
-        int D;
-        int L;
-        double C;
-        double w0;
-        double R_min;
-        double t;
-        unsigned seed;
-        
-        vector<RStarTreeIndex<K>> indices;
-        vector<vector<double>> datos;
-        vector<vector<vector<double>>> a;
-
-        void generarFuncionesHash() {
-            a.resize(L);
-            mt19937 gen(seed);
-            normal_distribution<double> dist(0.0, 1.0);
-            for(int i = 0; i < L; i++) {
-                a[i].resize(K);
-                for(size_t j = 0; j < K; j++) {
-                    a[i][j].resize(D);
-                    for(int k = 0; k < D; k++) {
-                        a[i][j][k] = dist(gen);
-                    }
-                }
-            }
-        }
-        
-        array<double, K> funcionHash(const vector<double>& punto, int tabla) {
-            if(static_cast<int>(punto.size()) != D) {
-                throw runtime_error("Punto debe tener " + to_string(D) + " dimensiones");
-            }
-            
-            array<double, K> hash_result;
-            for(size_t i = 0; i < K; i++) {
-                hash_result[i] = 0.0;
-                for(int j = 0; j < D; j++) {
-                    hash_result[i] += a[tabla][i][j] * punto[j];
-                }
-            }
-            return hash_result;
-        }
-        
-        double distanciaEuclidiana(const vector<double>& p1, const vector<double>& p2) {
-            double sum = 0.0;
-            for(size_t i = 0; i < p1.size(); i++) {
-                double diff = p1[i] - p2[i];
-                sum += diff * diff;
-            }
-            return sqrt(sum);
-        }
-
-    public:
-        vector<pair<int, double>> encontrarKVecinosReales(const vector<double>& query, int k) {
-            vector<pair<double, int>> distancias;
-            distancias.reserve(datos.size());
-            
-            for(size_t i = 0; i < datos.size(); i++) {
-                double dist = distanciaEuclidiana(query, datos[i]);
-                distancias.push_back({dist, i});
-            }
-            
-            partial_sort(distancias.begin(), 
-                        distancias.begin() + min(k, (int)distancias.size()),
-                        distancias.end());
-            
-            vector<pair<int, double>> resultado;
-            int num_vecinos = min(k, (int)distancias.size());
-            for(int i = 0; i < num_vecinos; i++) {
-                resultado.push_back({distancias[i].second, distancias[i].first});
-            }
-            return resultado;
-        }
-        
-        DBLSH(int dim, int L_, double C_, double R_min_, double t_, unsigned seed_ = 42) 
-            : D(dim), L(L_), C(C_), R_min(R_min_), t(t_), seed(seed_) {
-            w0 = R_min * 4.0 * C * C;
-            indices.resize(L);
-            generarFuncionesHash();
-        }
-
-        void insertar(const vector<vector<double>>& datos_input){
-            datos = datos_input;
-            vector<vector<pair<array<double, K>, int>>> proyecciones;
-            proyecciones.resize(L);
-            
-            for(int i = 0; i < L; i++) {
-                proyecciones[i].reserve(datos.size());
-                for (size_t j = 0; j < datos.size(); j++){
-                    array<double, K> hash_punto = funcionHash(datos[j], i);
-                    int id = static_cast<int>(j);
-                    proyecciones[i].push_back({hash_punto, id});
-                }
-                indices[i].bulkLoad(proyecciones[i]);
-            }
-        }
-        
-        vector<tuple<int, vector<double>, double>> RC_NN_K(const vector<double>& query, double r, double c, int k, int T){
-            vector<tuple<int, vector<double>, double>> candidatos;
-            set<int> ids_visitados;
-            int cnt = 0;
-            
-            for(int i = 0; i < L; i++){
-                array<double, K> hash_query = funcionHash(query, i);
-                double w_r = w0 * r;
-                double threshold = w_r / 2.0;
-                
-                array<double, K> mins, maxs;
-                for(size_t j = 0; j < K; j++) {
-                    mins[j] = hash_query[j] - threshold;
-                    maxs[j] = hash_query[j] + threshold;
-                }
-                
-                vector<typename RStarTreeIndex<K>::Value> resultados = indices[i].windowQuery(mins, maxs);
-
-                for(const auto& res : resultados) {
-                    int id = res.second;
-                    if(ids_visitados.count(id)) continue;
-                    ids_visitados.insert(id);
-                    
-                    const vector<double>& punto_original = datos[id];
-                    double dist = distanciaEuclidiana(query, punto_original);
-                    cnt++;
-                    
-                    if(dist <= c * r) {
-                        candidatos.push_back({id, punto_original, dist});
-                        if((int)candidatos.size() >= k) {
-                            return candidatos;
-                        }
-                    }
-                    
-                    if(cnt >= T) {
-                        return candidatos;
-                    }
-                }
-            }
-            return candidatos;
-        }
-        
-        vector<tuple<int, vector<double>, double>> C_ANN_K(const vector<double>& query, double c, int k){
-            //double t = 1.0;
-            // if (N < 70000) t = 200.0;
-            // else if (N < 500000) t = 1000.0;
-            // else if (N < 2000000) t = 2000.0;
-            // else t = 20000.0;
-            // t *= 2.0;
-            
-            int T = 2*t*L + k;
-            double r = R_min;
-            
-            vector<tuple<int, vector<double>, double>> acumulados;
-            set<int> ids_usados;
-            
-            // int rounds = 0;
-            // const int MAX_ROUNDS = 30;
-            
-            while(true) {
-                // rounds++;
-                auto nuevos = RC_NN_K(query, r, c, k, T);
-                
-                for(const auto& candidato : nuevos) {
-                    int id = get<0>(candidato);
-                    if(ids_usados.find(id) == ids_usados.end()) {
-                        ids_usados.insert(id);
-                        acumulados.push_back(candidato);
-                    }
-                }
-                
-                if((int)acumulados.size() >= k) {
-                    sort(acumulados.begin(), acumulados.end(), 
-                         [](const auto& a, const auto& b) { return get<2>(a) < get<2>(b); });
-                    acumulados.resize(min(k, (int)acumulados.size()));
-                    return acumulados;
-                }
-                
-                r *= c;
-            }
-            
-            sort(acumulados.begin(), acumulados.end(),
-                 [](const auto& a, const auto& b) { return get<2>(a) < get<2>(b); });
-            return acumulados;
-        }
-
-        int getDatasetSize() const { return datos.size(); }
-};
-
 vector<vector<double>> loadDataset(const string& path, size_t max_rows = 5000) {
+    TRACE_SCOPE("loadDataset");
     ifstream f(path);
     if (!f) throw runtime_error("No se pudo abrir " + path);
 
@@ -274,9 +87,23 @@ double calcularRecallKNN(const vector<tuple<int, vector<double>, double>>& vecin
 #define MAIN_t 8000
 #define MAIN_K 83
 #define MAIN_L 2
+#define MAIN_FORMATO FormatoPuntos::F64  // U8: píxeles 0-255 en almacén compacto, distancia exacta entera
+#define MAIN_FAMILIA FamiliaHash::GAUSSIANA  // GAUSSIANA, HADAMARD o ACHLIOPTAS
+#define MAIN_D_FIJA 784  // Dimensión original fijada en compilación (kernels de trip count fijo); 0 = en ejecución
+#define MAIN_MUESTRA_RADIOS 0  // Puntos para aprender el radio inicial de C_ANN_K, p. ej. 256 (0 = r *= c desde R_min)
+#define MAIN_PQ_M 0           // >0 activa el prefiltro PQ (bytes por punto)
+#define MAIN_PQ_FRACCION 0.1  // Fracción de candidatos con distancia exacta
+#define MAIN_PIPELINE_HILOS 0  // Hilos productores del RC_NN_K en pipeline (0 = secuencial)
+#define MAIN_ORDEN OrdenAlmacen::ENTRADA  // ENTRADA, MORTON o KMEANS (localidad del almacén)
+#define MAIN_ORDEN_PROYECTADO false  // Verificar por distancia proyectada y podar con χ²_K
+#define MAIN_CONFIANZA_CHI2 0.999    // Confianza de la poda (1 = solo ordenar)
+#define MAIN_PERF false  // Contadores hardware (perf_event_open) en construcción y queries
+#define MAIN_TRAZA ""  // Ruta del JSON de trazas (Chrome/Perfetto), p.ej. "results/traza_grafico.json"; "" = desactivado
 
 int main(){
     std::filesystem::create_directories("results");
+    const string ruta_traza = MAIN_TRAZA;
+    traza::activar(!ruta_traza.empty());
 
     cout << "============================================================" << endl;
     cout << "DB-LSH: Replicación de Gráficos del Paper (Fig. 5, 6, 7)" << endl;
@@ -307,12 +134,42 @@ int main(){
         queries.push_back(full_dataset[i]);
     }
 
+    // Resto en un único buffer n×D compartido: cada n indexa un prefijo (vista)
+    // en lugar de copiar sus filas
+    const size_t total_index = full_dataset.size() - K_QUERIES;
+    vector<double> plano;
+    plano.reserve(total_index * D);
+    for(size_t i = K_QUERIES; i < full_dataset.size(); i++) {
+        plano.insert(plano.end(), full_dataset[i].begin(), full_dataset[i].end());
+        vector<double>().swap(full_dataset[i]);
+    }
+    full_dataset.clear();
+    const VistaMatriz vista_index(plano.data(), total_index, D);
+
     // Proporciones n a probar (como en Fig. 5, 6, 7)
     vector<double> n_values = {0.2, 0.4, 0.6, 0.8, 1.0};
     
     // Abrir archivo CSV para resultados
     ofstream csv_file("results/varying_n_results.csv");
-    csv_file << "n,avg_recall,avg_ratio,avg_time_ms\n";
+    csv_file << "n,avg_recall,avg_ratio,avg_time_ms,avg_verificados";
+    for(size_t i = 0; i < ContadoresHW::NUM_CONTADORES; i++) csv_file << ",build_" << ContadoresHW::nombre(i);
+    for(size_t i = 0; i < ContadoresHW::NUM_CONTADORES; i++) csv_file << ",query_" << ContadoresHW::nombre(i);
+    csv_file << ",ipc,cycles_por_candidato,llc_misses_por_candidato,dtlb_misses_por_candidato,branch_misses_por_candidato\n";
+
+    // Contadores hardware: si no hay (VM, contenedor, perf_event_paranoid) las columnas quedan en NA
+    ContadoresHW perf;
+    const bool usar_perf = MAIN_PERF && perf.disponible();
+    if(MAIN_PERF && !usar_perf) {
+        cout << "Contadores hardware no disponibles (" << perf.error() << "): columnas NA" << endl;
+    }
+    auto valorPerf = [](const ContadoresHW::Lectura& l, size_t i, double divisor) -> string {
+        if(!l.validos[i] || divisor <= 0) return "NA";
+        return to_string(l.valores[i] / divisor);
+    };
+    ofstream csv_queries("results/varying_n_queries.csv");
+    csv_queries << "n,query,time_ms,verificados";
+    for(size_t i = 0; i < ContadoresHW::NUM_CONTADORES; i++) csv_queries << "," << ContadoresHW::nombre(i);
+    csv_queries << "\n";
     
     cout << "\n" << string(70, '=') << endl;
     cout << "EXPERIMENTO: Variando n (proporción del dataset)" << endl;
@@ -326,37 +183,52 @@ int main(){
     
     for(double n : n_values) {
         // Calcular tamaño del dataset
-        int dataset_size = static_cast<int>(n * (full_dataset.size() - K_QUERIES));
+        int dataset_size = static_cast<int>(n * total_index);
         
         cout << "\n[n = " << n << "] Dataset: " << dataset_size << " puntos" << endl;
         
-        // Tomar subset del dataset (después de las queries)
-        vector<vector<double>> dataset_index;
-        for(int i = 0; i < dataset_size; i++) {
-            dataset_index.push_back(full_dataset[K_QUERIES + i]);
-        }
+        // Subset del dataset (después de las queries): prefijo sin copia
+        VistaMatriz dataset_index = vista_index.prefijo(dataset_size);
         
         // Construir índice DB-LSH
         cout << "  Construyendo índice DB-LSH..." << flush;
-        DBLSH<K> indice(D, L, C, R_MIN, t, 42);
+        DBLSH<K, MAIN_D_FIJA> indice(D, L, C, R_MIN, t, 42, MAIN_FAMILIA, false);
+        indice.configurarAlmacen(MAIN_FORMATO);
+        indice.configurarRadioAprendido(MAIN_MUESTRA_RADIOS);
+        indice.configurarPQ(MAIN_PQ_M, MAIN_PQ_FRACCION);
+        indice.configurarPipeline(MAIN_PIPELINE_HILOS);
+        indice.configurarOrden(MAIN_ORDEN);
+        indice.configurarOrdenProyectado(MAIN_ORDEN_PROYECTADO, MAIN_CONFIANZA_CHI2);
+        if(usar_perf) perf.iniciar();
         indice.insertar(dataset_index);
+        ContadoresHW::Lectura perf_build = usar_perf ? perf.detener() : ContadoresHW::Lectura();
         cout << " OK" << endl;
         
         // Ejecutar queries y medir métricas
         double total_recall = 0.0;
         double total_ratio = 0.0;
         double total_time_ms = 0.0;
+        size_t total_verificados = 0;
+        ContadoresHW::Lectura perf_queries;
         
         cout << "  Ejecutando " << K_QUERIES << " queries..." << flush;
         for(int q = 0; q < K_QUERIES; q++) {
             const auto& query = queries[q];
             
-            // Medir tiempo de query
+            // Medir tiempo (y contadores) de query
+            EstadisticasConsulta st;
+            if(usar_perf) perf.iniciar();
             auto start = high_resolution_clock::now();
-            auto vecinos_dblsh = indice.C_ANN_K(query, C, K_NN);
+            auto vecinos_dblsh = indice.C_ANN_K(query, C, K_NN, &st);
             auto end = high_resolution_clock::now();
+            ContadoresHW::Lectura perf_query = usar_perf ? perf.detener() : ContadoresHW::Lectura();
+            perf_queries += perf_query;
+            total_verificados += st.verificados;
             
             double query_time_ms = duration_cast<microseconds>(end - start).count() / 1000.0;
+            csv_queries << n << "," << q << "," << query_time_ms << "," << st.verificados;
+            for(size_t i = 0; i < ContadoresHW::NUM_CONTADORES; i++) csv_queries << "," << valorPerf(perf_query, i, 1.0);
+            csv_queries << "\n";
             
             // Ground truth
             auto vecinos_reales = indice.encontrarKVecinosReales(query, K_NN);
@@ -381,11 +253,23 @@ int main(){
         cout << "    Ratio: " << avg_ratio << "x" << endl;
         cout << "    Query time: " << avg_time_ms << " ms" << endl;
         
-        // Guardar en CSV
-        csv_file << n << "," << avg_recall << "," << avg_ratio << "," << avg_time_ms << "\n";
+        // Guardar en CSV (contadores de query: media por query y por candidato verificado)
+        csv_file << n << "," << avg_recall << "," << avg_ratio << "," << avg_time_ms << ","
+                 << static_cast<double>(total_verificados) / K_QUERIES;
+        for(size_t i = 0; i < ContadoresHW::NUM_CONTADORES; i++) csv_file << "," << valorPerf(perf_build, i, 1.0);
+        for(size_t i = 0; i < ContadoresHW::NUM_CONTADORES; i++) csv_file << "," << valorPerf(perf_queries, i, K_QUERIES);
+        bool ipc_valido = perf_queries.validos[ContadoresHW::CICLOS] && perf_queries.validos[ContadoresHW::INSTRUCCIONES]
+                          && perf_queries.valores[ContadoresHW::CICLOS] > 0;
+        csv_file << "," << (ipc_valido ? to_string(static_cast<double>(perf_queries.valores[ContadoresHW::INSTRUCCIONES])
+                                                   / perf_queries.valores[ContadoresHW::CICLOS]) : string("NA"));
+        for(size_t i : {ContadoresHW::CICLOS, ContadoresHW::LLC_MISSES, ContadoresHW::DTLB_MISSES, ContadoresHW::BRANCH_MISSES}) {
+            csv_file << "," << valorPerf(perf_queries, i, static_cast<double>(total_verificados));
+        }
+        csv_file << "\n";
     }
     
     csv_file.close();
+    csv_queries.close();
     
     cout << "\n" << string(70, '=') << endl;
     cout << "Resultados guardados en: results/varying_n_results.csv" << endl;
@@ -416,5 +300,10 @@ int main(){
     }
     csv_read.close();
 
+    if(!ruta_traza.empty()) {
+        traza::exportarChrome(ruta_traza);
+        cout << "[Trazas guardadas en " << ruta_traza << "]" << endl;
+    }
+
     return 0;
 }
@@ -1,7 +1,7 @@
 #include <iostream>
 #include <fstream>
 #include <sstream>
-#include "R_star2.h"
+#include "DBLSH.h"
 #include <vector>
 #include <tuple>
 #include <cmath>
@@ -9,286 +9,13 @@
 #include <random>
 #include <set>
 #include <filesystem>
+#include <chrono>
 
 using namespace std;
-// clase  
-template <size_t K> // Número de funciones hash = dimensión proyectada (ahora K=10)
-class DBLSH {
-    private:
-        int D;      // Dimensión original (ej: 2, 10, 128, 700)
-        int L;      // Número de tablas hash
-        double C;   // Constante de aproximación
-        double w0;  // Ancho de ventana base
-        double R_min; // Radio mínimo inicial
-        double t;
-        unsigned seed; // Semilla para reproducibilidad
-        
-        vector<RStarTreeIndex<K>> indices;
-        
-        // Almacena los puntos originales (índice del vector = id del punto)
-        vector<vector<double>> datos;
-
-        // Matriz de proyección: K filas × D columnas
-        // a[i][j] = coeficiente de la función hash i para la dimensión j
-        vector<vector<vector<double>>> a;
-
-        // Generar funciones hash aleatorias
-        void generarFuncionesHash() {
-            a.resize(L);
-            mt19937 gen(seed);
-            normal_distribution<double> dist(0.0, 1.0);
-            for(int i = 0; i < L; i++) {
-                a[i].resize(K);
-                
-                for(size_t j = 0; j < K; j++) {
-                    a[i][j].resize(D);
-                    
-                    // Generar vector aleatorio N(0,1)
-                    for(int k = 0; k < D; k++) {
-                        a[i][j][k] = dist(gen);
-                    }
-                }
-            }
-        }
-        
-        // Proyectar punto N-dimensional → K-dimensional (K=10)
-        array<double, K> funcionHash(const vector<double>& punto, int tabla) {
-            if(static_cast<int>(punto.size()) != D) {
-                throw runtime_error("Punto debe tener " + to_string(D) + " dimensiones");
-            }
-            
-            array<double, K> hash_result;
-            
-            // h_i(p) = a[i] · p (producto punto) para cada función hash
-            for(size_t i = 0; i < K; i++) {
-                hash_result[i] = 0.0;
-                for(int j = 0; j < D; j++) {
-                    hash_result[i] += a[tabla][i][j] * punto[j];
-                }
-            }
-            
-            return hash_result;
-        }
-        
-        // Distancia euclidiana en espacio original N-dimensional
-        double distanciaEuclidiana(const vector<double>& p1, const vector<double>& p2) {
-            double sum = 0.0;
-            for(size_t i = 0; i < p1.size(); i++) {
-                double diff = p1[i] - p2[i];
-                sum += diff * diff;
-            }
-            return sqrt(sum);
-        }
-
-
-    public:
-        // Ground Truth: Encontrar k vecinos más cercanos reales (fuerza bruta)
-        vector<pair<int, double>> encontrarKVecinosReales(const vector<double>& query, int k) {
-            // Calcular distancias a todos los puntos
-            vector<pair<double, int>> distancias;
-            distancias.reserve(datos.size());
-            
-            for(size_t i = 0; i < datos.size(); i++) {
-                double dist = distanciaEuclidiana(query, datos[i]);
-                distancias.push_back({dist, i});
-            }
-            
-            // Ordenar por distancia (parcial sort hasta k)
-            partial_sort(distancias.begin(), 
-                        distancias.begin() + min(k, (int)distancias.size()),
-                        distancias.end());
-            
-            // Retornar los k primeros como {id, distancia}
-            vector<pair<int, double>> resultado;
-            int num_vecinos = min(k, (int)distancias.size());
-            for(int i = 0; i < num_vecinos; i++) {
-                resultado.push_back({distancias[i].second, distancias[i].first});
-            }
-            
-            return resultado;
-        }
-        
-        // Constructor con parámetros del paper DB-LSH (según código original)
-        // D: dimensión original, L: número de tablas hash, C: approximation ratio
-        // R_min: radio inicial mínimo, beta: proporción máxima de accesos (0-1)
-        // w0 = R_min * 4C² según código original del paper
-        DBLSH(int dim, int L_, double C_, double R_min_, double t_, unsigned seed_ = 42) 
-            : D(dim), L(L_), C(C_), R_min(R_min_), t(t_), seed(seed_) {
-            w0 = R_min * 4.0 * C * C;  // Fórmula del código original
-            indices.resize(L);
-            generarFuncionesHash();
-            
-            cout << "DB-LSH inicializado (según implementación original):" << endl;
-            cout << "  Dimensión original: " << D << "D" << endl;
-            cout << "  Dimensión proyectada: " << K << "D (R*-tree " << K << "D)" << endl;
-            cout << "  Tablas hash: " << L << endl;
-            cout << "  C = " << C << ", R_min = " << R_min << ", t = " << t << endl;
-            cout << "  w0 = " << w0 << " (R_min * 4C²)" << endl;
-            cout << "  Semilla: " << seed << endl;
-        }
-
-        void insertar(const vector<vector<double>>& datos_input){
-            // Guardar datos originales
-            datos = datos_input;
-            
-            cout << "\nIndexando " << datos.size() << " puntos de " << D << "D..." << endl;
-            cout << "Usando bulk-loading (paper DB-LSH)" << endl;
-            
-            // Proyectar TODOS los puntos primero (preparación para bulk-loading)
-            vector<vector<pair<array<double, K>, int>>> proyecciones;
-            proyecciones.resize(L);
-            // Proyectar y guardar en R*-tree con ID = índice del vector
-            for(int i = 0; i < L; i++) {
-                proyecciones[i].reserve(datos.size());
-                for (size_t j = 0; j < datos.size(); j++){
-                    array<double, K> hash_punto = funcionHash(datos[j], i);
-                    int id = static_cast<int>(j);  // ID = índice en vector datos
-                    proyecciones[i].push_back({hash_punto, id});
-                }
-                // Bulk-loading: construir R*-tree de una sola vez (más eficiente según paper DB-LSH)
-                indices[i].bulkLoad(proyecciones[i]);
-            }
-                        
-            cout << "Proyecciones generadas (primeros 5):" << endl;
-            for (size_t i = 0; i < min((size_t)5, datos.size()); i++) {
-                auto hash = funcionHash(datos[i], 0);
-                cout << "  Punto[" << i << "] " << D << "D -> Hash "<< K << "D: [";
-                for(size_t k = 0; k < K; k++) {
-                    cout << hash[k];
-                    if(k < K-1) cout << ", ";
-                }
-                cout << "]" << endl;
-            }
-            if(datos.size() > 5) {
-                cout << "  ... (" << (datos.size() - 5) << " más)" << endl;
-            }
-            cout << endl;
-        }
-        void imprimir(){
-            for(int i = 0; i < L; i++) {
-                indices[i].printStats();
-            }
-        }
-        
-        
-        // Algorithm 1 (modificado): (r,c)-NN Query para k vecinos
-        // Input: q (query point), r (query radius), c (approximation ratio), k (num neighbors), T (límite de accesos)
-        // Output: Lista de hasta k puntos con {id, punto, distancia}
-        vector<tuple<int, vector<double>, double>> RC_NN_K(const vector<double>& query, double r, double c, int k, int T){
-            vector<tuple<int, vector<double>, double>> candidatos; // {id, punto, distancia}
-            set<int> ids_visitados; // Evitar duplicados entre tablas
-            int cnt = 0;
-            
-            // Para cada tabla i = 1 to L
-            for(int i = 0; i < L; i++){
-                array<double, K> hash_query = funcionHash(query, i);
-                double w_r = w0 * r;
-                double threshold = w_r / 2.0;
-                
-                array<double, K> mins, maxs;
-                for(size_t j = 0; j < K; j++) {
-                    mins[j] = hash_query[j] - threshold;
-                    maxs[j] = hash_query[j] + threshold;
-                }
-                
-                vector<typename RStarTreeIndex<K>::Value> resultados = indices[i].windowQuery(mins, maxs);
-
-                for(const auto& res : resultados) {
-                    int id = res.second;
-                    
-                    // Evitar duplicados
-                    if(ids_visitados.count(id)) continue;
-                    ids_visitados.insert(id);
-                    
-                    const vector<double>& punto_original = datos[id];
-                    double dist = distanciaEuclidiana(query, punto_original);
-                    cnt++;
-                    
-                    // Agregar si dist ≤ cr
-                    if(dist <= c * r) {
-                        candidatos.push_back({id, punto_original, dist});
-                        if((int)candidatos.size() >= k) {
-                            return candidatos; // Terminación temprana si ya tenemos k
-                        }
-                    }
-                    
-                    // Terminación por límite de accesos T (según código original)
-                    if(cnt >= T) {
-                        return candidatos;
-                    }
-                }
-            }
-            return candidatos;
-        }
-        
-        // Algorithm 2 (modificado según código original): c-ANN Query para k vecinos
-        // Input: q (query point), c (approximation ratio), k (num neighbors)
-        // Output: Lista de k puntos con {id, punto, distancia}
-        vector<tuple<int, vector<double>, double>> C_ANN_K(const vector<double>& query, double c, int k){
-            // Calcular parámetro t adaptativo según tamaño N (código original)
-            // int N = datos.size();
-            //double t = 1.0;
-            // if (N < 70000) {
-            //     t = 200.0;
-            // } else if (N >= 70000 && N < 500000) {
-            //     t = 1000.0;
-            // } else if (N >= 500000 && N < 2000000) {
-            //     t = 2000.0;
-            // } else if (N >= 2000000 && N < 2000000000) {
-            //     t = 20000.0;
-            // } else {
-            //     t = 20000.0;
-            // }
-            // t *= 2.0;
-            
-            int T = 2*t*L + k;
-            double r = R_min;
-
-            
-            // Acumular candidatos entre iteraciones con IDs
-            vector<tuple<int, vector<double>, double>> acumulados;
-            set<int> ids_usados; // Para evitar duplicados usando IDs reales
-            
-            // int rounds = 0;
-            // const int MAX_ROUNDS = 30;  // Límite de 30 rondas (código original)
-            
-            while(true){
-                // rounds++;
-                auto nuevos = RC_NN_K(query, r, c, k, T);  // r = init_w/w0
-                
-                // Agregar nuevos candidatos evitando duplicados
-                for(const auto& candidato : nuevos) {
-                    int id = get<0>(candidato);
-                    
-                    if(ids_usados.find(id) == ids_usados.end()) {
-                        ids_usados.insert(id);
-                        acumulados.push_back(candidato);
-                    }
-                }
-                
-                if((int)acumulados.size() >= k) {
-                    // Ordenar por distancia y retornar los k mejores
-                    sort(acumulados.begin(), acumulados.end(), 
-                         [](const auto& a, const auto& b) { return get<2>(a) < get<2>(b); });
-                    
-                    acumulados.resize(min(k, (int)acumulados.size()));
-                    return acumulados;
-                }
-                
-                // Expandir ventana w para siguiente iteración (código original)
-                r *= c;
-            }
-            
-            // Si no se encontraron k vecinos después de MAX_ROUNDS, retornar lo acumulado
-            sort(acumulados.begin(), acumulados.end(),
-                 [](const auto& a, const auto& b) { return get<2>(a) < get<2>(b); });
-            return acumulados;
-        }
-
 
-};
-
-vector<vector<double>> loadDataset(const string& path, size_t max_rows = 5000) {
+// etiquetas (opcional): recibe la primera columna (clase) de cada fila cargada
+vector<vector<double>> loadDataset(const string& path, size_t max_rows = 5000, vector<int>* etiquetas = nullptr) {
+    TRACE_SCOPE("loadDataset");
     ifstream f(path);
     if (!f) throw runtime_error("No se pudo abrir " + path);
 
@@ -301,15 +28,19 @@ vector<vector<double>> loadDataset(const string& path, size_t max_rows = 5000) {
         stringstream ss(line);
         string cell;
 
-        // salta label
+        // label
         if (!getline(ss, cell, ',')) continue;
+        int etiqueta = etiquetas ? stoi(cell) : 0;
 
         vector<double> row;
         row.reserve(784);
         while (getline(ss, cell, ',')) {
             row.push_back(stod(cell));
         }
-        if (row.size() == 784) datos.push_back(move(row));
+        if (row.size() == 784) {
+            datos.push_back(move(row));
+            if (etiquetas) etiquetas->push_back(etiqueta);
+        }
     }
     return datos;
 }
@@ -392,16 +123,33 @@ double calcularRecallKNN(const vector<tuple<int, vector<double>, double>>& vecin
 #define MAIN_t 500
 #define MAIN_K 68
 #define MAIN_L 18
+#define MAIN_FAMILIA FamiliaHash::GAUSSIANA  // GAUSSIANA, HADAMARD o ACHLIOPTAS
+#define MAIN_D_FIJA 784  // Dimensión original fijada en compilación (kernels de trip count fijo); 0 = en ejecución
+#define MAIN_MUESTRA_RADIOS 0  // Puntos para aprender el radio inicial de C_ANN_K, p. ej. 256 (0 = r *= c desde R_min)
+#define MAIN_FORMATO FormatoPuntos::F64  // U8: píxeles 0-255 en almacén compacto, distancia exacta entera
+#define MAIN_RANGO_K 0  // Búsqueda por rango con radio = distancia real al vecino MAIN_RANGO_K, p. ej. 100 (0 = desactivado)
+#define MAIN_PRESUPUESTO_MB 0  // Memoria máxima del índice (0 = sin límite); si no cabe se degrada
+#define MAIN_DIAGNOSTICO_RADIO 0.0  // Radio r de las ventanas w0·r del diagnóstico de R*-trees, p. ej. 1.0 (0 = desactivado)
+#define MAIN_FILTRO_ETIQUETA -1  // k-NN restringido a esta clase, p. ej. 3 (-1 = desactivado)
+#define MAIN_SUBINDICE_ETIQUETAS 0.0  // Fracción máxima de n de una clase con sub-índice propio (0 = solo bitmap)
+#define MAIN_DISCO ""  // Índice fuera de memoria sobre este archivo, p. ej. "results/fashion_mnist.dblsh" ("" = desactivado)
+#define MAIN_DISCO_CACHE 1024  // Filas en la caché LRU del índice fuera de memoria
+#define MAIN_K_ARBOL 0  // Comparar con un índice híbrido: R*-tree de estas coordenadas (p. ej. 8) + filtro SoA (0 = desactivado)
+#define MAIN_PLANIFICADOR false  // Comparar con el planificador por costo (árbol / escaneo / fuerza bruta por ronda)
+#define MAIN_TRAZA ""  // Ruta del JSON de trazas (Chrome/Perfetto), p.ej. "results/traza_k.json"; "" = desactivado
 
 int main(){
     std::filesystem::create_directories("results");
+    const string ruta_traza = MAIN_TRAZA;
+    traza::activar(!ruta_traza.empty());
 
     cout << "============================================================" << endl;
     cout << "DB-LSH: Evaluación con k=50 Queries" << endl;
     cout << "============================================================" << endl;
 
     cout << "Cargando Fashion-MNIST...\n";
-    vector<vector<double>> full_dataset = loadDataset("fashion_mnist.csv", 60000);
+    vector<int> etiquetas;
+    vector<vector<double>> full_dataset = loadDataset("fashion_mnist.csv", 60000, &etiquetas);
     cout << "Filas cargadas: " << full_dataset.size() << endl;
 
     const int D = 784;
@@ -413,9 +161,12 @@ int main(){
     const int K_QUERIES = 50;
     const double R_MIN = 1;  // Radio inicial mínimo (parámetro típico del paper)
     
-    // Shuffle dataset
+    // Shuffle dataset (las etiquetas con una copia del generador: misma permutación)
     mt19937 gen(42);
+    mt19937 gen_etiquetas = gen;
     shuffle(full_dataset.begin(), full_dataset.end(), gen);
+    shuffle(etiquetas.begin(), etiquetas.end(), gen_etiquetas);
+    etiquetas.erase(etiquetas.begin(), etiquetas.begin() + K_QUERIES);
     
     // Tomar primeras K_QUERIES como queries
     vector<vector<double>> queries;
@@ -423,20 +174,49 @@ int main(){
         queries.push_back(full_dataset[i]);
     }
     
-    // Resto para indexar
-    vector<vector<double>> dataset_index;
+    // Resto para indexar: un único buffer n×D (cada fila se libera al copiarla)
+    // que el índice recibe por move, sin una segunda copia del dataset
+    vector<double> dataset_index;
+    dataset_index.reserve((full_dataset.size() - K_QUERIES) * D);
     for(size_t i = K_QUERIES; i < full_dataset.size(); i++) {
-        dataset_index.push_back(full_dataset[i]);
+        dataset_index.insert(dataset_index.end(), full_dataset[i].begin(), full_dataset[i].end());
+        vector<double>().swap(full_dataset[i]);
     }
+    full_dataset.clear();
     
     cout << "Queries: " << queries.size() << endl;
-    cout << "Dataset indexado: " << dataset_index.size() << endl;
+    cout << "Dataset indexado: " << dataset_index.size() / D << endl;
 
     // Construir índice DB-LSH (con parámetros del código original)
-    DBLSH<K> indice(D, L, C, R_MIN, t, 42); // D=784, L=5 , C=1.5, R_min=0.3, beta=0.1, seed=42 
-    indice.insertar(dataset_index);
+    DBLSH<K, MAIN_D_FIJA> indice(D, L, C, R_MIN, t, 42, MAIN_FAMILIA); // D=784, L=5 , C=1.5, R_min=0.3, beta=0.1, seed=42 
+    indice.configurarAlmacen(MAIN_FORMATO);
+    indice.configurarRadioAprendido(MAIN_MUESTRA_RADIOS);
+    indice.configurarEtiquetas(move(etiquetas), MAIN_SUBINDICE_ETIQUETAS);
+    if(MAIN_PRESUPUESTO_MB > 0) {
+        indice.configurarPresupuesto(size_t(MAIN_PRESUPUESTO_MB) << 20, PoliticaPresupuesto::DEGRADAR);
+    }
+    indice.insertar(move(dataset_index));
     indice.imprimir();
 
+    // Diagnóstico estructural de los árboles (results/arbol_diagnostico.csv)
+    if(MAIN_DIAGNOSTICO_RADIO > 0) {
+        auto diagnostico = indice.diagnosticoArboles(queries, MAIN_DIAGNOSTICO_RADIO);
+        imprimirDiagnosticoArboles(diagnostico, indice.anchoVentana(MAIN_DIAGNOSTICO_RADIO));
+        ofstream diag_csv("results/arbol_diagnostico.csv");
+        diag_csv << "tabla,nivel,nodos,llenado,log10_volumen,margen,fraccion_hermanos_solapados,solapamiento,"
+                    "espacio_muerto,internos_por_ventana,hojas_por_ventana,fraccion_hojas\n";
+        for(size_t i = 0; i < diagnostico.size(); i++) {
+            const auto& d = diagnostico[i];
+            for(size_t nv = 0; nv < d.arbol.niveles.size(); nv++) {
+                const auto& n = d.arbol.niveles[nv];
+                diag_csv << i << "," << nv << "," << n.nodos << "," << n.llenado(d.arbol.capacidad) << ","
+                         << n.log10Volumen() << "," << n.margen() << "," << n.fraccionSolapada() << ","
+                         << n.solapamiento() << "," << n.espacioMuerto() << "," << d.internos_por_ventana << ","
+                         << d.hojas_por_ventana << "," << d.fraccionHojas() << "\n";
+            }
+        }
+    }
+
     // ============ EJECUTAR k-NN QUERIES ============
     // Probar con diferentes valores de k (como en la Figura 5 del paper)
     vector<int> k_values = {1, 10, 20, 30, 40, 50, 60, 70, 80, 90, 100};
@@ -492,7 +272,170 @@ int main(){
     csv_read.close();
     
     cout << "\n[Resultados guardados en results/knn_results.csv]" << endl;
+
+    // ============ BÚSQUEDA POR RANGO ============
+    if(MAIN_RANGO_K > 0) {
+        ThreadPool pool;
+        auto reales = indice.encontrarKVecinosReales(query, MAIN_RANGO_K);
+        double radio = reales.back().second;
+        set<int> ids_reales;
+        for(const auto& v : reales) ids_reales.insert(v.first);
+
+        size_t aciertos = 0;
+        size_t encontrados = indice.rangeSearch(query, radio, [&](int id, double) {
+            aciertos += ids_reales.count(id);
+        }, pool);
+        cout << "\nBúsqueda por rango (r = " << radio << "): " << encontrados << " puntos, "
+             << aciertos << "/" << reales.size() << " de los vecinos reales" << endl;
+    }
+
+    // ============ k-NN FILTRADO POR ETIQUETA ============
+    // Filtro en el índice frente a la alternativa sin filtro: pedir k/selectividad
+    // vecinos y quedarse con los de la clase
+    if(MAIN_FILTRO_ETIQUETA >= 0) {
+        const int k = 50;
+        FiltroPuntos filtro = indice.filtroEtiquetas({MAIN_FILTRO_ETIQUETA});
+        auto reales = indice.encontrarKVecinosReales(query, k, &filtro);
+
+        EstadisticasConsulta st_filtro;
+        auto vecinos = indice.C_ANN_K(query, C, k, filtro, {}, &st_filtro);
+
+        EstadisticasConsulta st_post;
+        int k_post = static_cast<int>(ceil(static_cast<double>(k) * indice.getDatasetSize() / max<size_t>(1, filtro.seleccionados)));
+        vector<tuple<int, vector<double>, double>> post;
+        for(auto& v : indice.C_ANN_K(query, C, min(k_post, indice.getDatasetSize()), &st_post)) {
+            if(indice.etiqueta(get<0>(v)) == MAIN_FILTRO_ETIQUETA && (int)post.size() < k) post.push_back(move(v));
+        }
+
+        cout << "\nk-NN filtrado (clase " << MAIN_FILTRO_ETIQUETA << ", " << filtro.seleccionados << " puntos, "
+             << (indice.numSubindices() > 0 ? "sub-índices" : "bitmap") << ", k = " << k << "):" << endl;
+        cout << "  Filtro en el índice: recall " << calcularRecallKNN(vecinos, reales) << ", "
+             << st_filtro.verificados << " distancias, " << st_filtro.filtrados << " rechazados por el filtro" << endl;
+        cout << "  Post-filtro (k = " << k_post << "): recall " << calcularRecallKNN(post, reales) << ", "
+             << st_post.verificados << " distancias, " << post.size() << " de la clase" << endl;
+    }
+
+    // ============ FUERA DE MEMORIA ============
+    // Mismo índice con las filas en un archivo binario: solo los R*-trees y la
+    // caché viven en RAM. Con los mismos parámetros las respuestas coinciden
+    const string ruta_disco = MAIN_DISCO;
+    if(!ruta_disco.empty()) {
+        vector<double> p;
+        escribirArchivoPuntos(ruta_disco, indice.getDatasetSize(), D, MAIN_FORMATO, [&](size_t j) {
+            p = indice.punto(static_cast<int>(j));
+            return p.data();
+        });
+        DBLSH<K, MAIN_D_FIJA> indice_disco(D, L, C, R_MIN, t, 42, MAIN_FAMILIA, false);
+        indice_disco.configurarRadioAprendido(MAIN_MUESTRA_RADIOS);
+        indice_disco.configurarDisco(MAIN_DISCO_CACHE);
+        indice_disco.insertarArchivo(ruta_disco);
+
+        const int k = 50;
+        size_t iguales = 0;
+        auto antes = indice_disco.contadoresDisco();
+        for(const auto& q : queries) {
+            auto en_memoria = indice.C_ANN_K(q, C, k);
+            auto en_disco = indice_disco.C_ANN_K(q, C, k);
+            bool igual = en_memoria.size() == en_disco.size();
+            for(size_t j = 0; igual && j < en_memoria.size(); j++) igual = get<0>(en_memoria[j]) == get<0>(en_disco[j]);
+            iguales += igual;
+        }
+        auto despues = indice_disco.contadoresDisco();
+        double por_query = 1.0 / queries.size();
+        cout << "\nFuera de memoria (" << ruta_disco << ", caché " << MAIN_DISCO_CACHE << " filas): almacén en RAM "
+             << indice_disco.bytesAlmacen() / 1024.0 << " KB vs " << indice.bytesAlmacen() / 1024.0 << " KB" << endl;
+        cout << "  k = " << k << ": " << iguales << "/" << queries.size() << " respuestas idénticas; por query "
+             << (despues.filas - antes.filas) * por_query << " filas, "
+             << (despues.lecturas - antes.lecturas) * por_query << " preads, "
+             << (despues.bytes - antes.bytes) * por_query / 1024.0 << " KB leídos, aciertos de caché "
+             << 100.0 * (despues.aciertos - antes.aciertos) / max<uint64_t>(1, despues.filas - antes.filas) << "%" << endl;
+    }
+
+    // ============ ÍNDICE HÍBRIDO ============
+    // Mismos parámetros con el R*-tree sobre las primeras MAIN_K_ARBOL
+    // coordenadas y el resto filtrado sobre columnas SoA: las ventanas dan los
+    // mismos puntos, solo cambian el orden de los candidatos y el costo
+    if(MAIN_K_ARBOL > 0 && MAIN_K_ARBOL < K) {
+        vector<double> plano;
+        plano.reserve(static_cast<size_t>(indice.getDatasetSize()) * D);
+        for(int j = 0; j < indice.getDatasetSize(); j++) {
+            vector<double> p = indice.punto(j);
+            plano.insert(plano.end(), p.begin(), p.end());
+        }
+        DBLSH<K, MAIN_D_FIJA, MAIN_K_ARBOL> indice_hibrido(D, L, C, R_MIN, t, 42, MAIN_FAMILIA, false);
+        indice_hibrido.configurarAlmacen(MAIN_FORMATO);
+        indice_hibrido.configurarRadioAprendido(MAIN_MUESTRA_RADIOS);
+        indice_hibrido.insertar(move(plano));
+
+        const int k = 50;
+        auto medir = [&](auto& idx, double& recall) {
+            recall = 0.0;
+            double ms = 0.0;
+            for(const auto& q : queries) {
+                auto inicio = chrono::high_resolution_clock::now();
+                auto vecinos = idx.C_ANN_K(q, C, k);
+                ms += chrono::duration<double, milli>(chrono::high_resolution_clock::now() - inicio).count();
+                recall += calcularRecallKNN(vecinos, idx.encontrarKVecinosReales(q, k));
+            }
+            recall /= queries.size();
+            return ms / queries.size();
+        };
+        double recall_completo, recall_hibrido;
+        double ms_completo = medir(indice, recall_completo);
+        double ms_hibrido = medir(indice_hibrido, recall_hibrido);
+        auto mb = [](size_t b) { return b / (1024.0 * 1024.0); };
+        cout << "\nÍndice híbrido (R*-tree de " << MAIN_K_ARBOL << "D + filtro SoA de " << K - MAIN_K_ARBOL
+             << " coordenadas, k = " << k << "):" << endl;
+        cout << "  R*-tree de " << K << "D: " << ms_completo << " ms/query, recall " << recall_completo
+             << ", árboles " << mb(indice.reporteMemoria().arboles) << " MB" << endl;
+        cout << "  Híbrido:        " << ms_hibrido << " ms/query, recall " << recall_hibrido
+             << ", árboles + columnas " << mb(indice_hibrido.reporteMemoria().arboles) << " MB" << endl;
+    }
     
+    // ============ PLANIFICADOR ============
+    // Mismos parámetros con el planificador por costo: cada ronda elige por
+    // tabla entre el R*-tree y el escaneo de la proyección plana, o pasa a
+    // fuerza bruta. Con n chico la fuerza bruta gana y la respuesta es exacta
+    if(MAIN_PLANIFICADOR) {
+        vector<double> plano;
+        plano.reserve(static_cast<size_t>(indice.getDatasetSize()) * D);
+        for(int j = 0; j < indice.getDatasetSize(); j++) {
+            vector<double> p = indice.punto(j);
+            plano.insert(plano.end(), p.begin(), p.end());
+        }
+        DBLSH<K, MAIN_D_FIJA> indice_plan(D, L, C, R_MIN, t, 42, MAIN_FAMILIA, false);
+        indice_plan.configurarAlmacen(MAIN_FORMATO);
+        indice_plan.configurarRadioAprendido(MAIN_MUESTRA_RADIOS);
+        indice_plan.configurarPlanificador(true);
+        indice_plan.insertar(move(plano));
+
+        const int k = 50;
+        auto medir = [&](auto& idx, double& recall, EstadisticasConsulta& st) {
+            recall = 0.0;
+            double ms = 0.0;
+            for(const auto& q : queries) {
+                auto inicio = chrono::high_resolution_clock::now();
+                auto vecinos = idx.C_ANN_K(q, C, k, &st);
+                ms += chrono::duration<double, milli>(chrono::high_resolution_clock::now() - inicio).count();
+                recall += calcularRecallKNN(vecinos, idx.encontrarKVecinosReales(q, k));
+            }
+            recall /= queries.size();
+            return ms / queries.size();
+        };
+        double recall_fijo, recall_plan;
+        EstadisticasConsulta st_fijo, st_plan;
+        double ms_fijo = medir(indice, recall_fijo, st_fijo);
+        double ms_plan = medir(indice_plan, recall_plan, st_plan);
+        cout << "\nPlanificador por costo (k = " << k << "):" << endl;
+        cout << "  Siempre R*-tree: " << ms_fijo << " ms/query, recall " << recall_fijo << ", "
+             << st_fijo.verificados / queries.size() << " distancias/query" << endl;
+        cout << "  Planificado:     " << ms_plan << " ms/query, recall " << recall_plan << ", "
+             << st_plan.verificados / queries.size() << " distancias/query" << endl;
+        cout << "  Decisiones: " << st_plan.plan_arbol << " ventanas con " << nombrePlan(PlanVentana::ARBOL) << ", "
+             << st_plan.plan_escaneo << " con " << nombrePlan(PlanVentana::ESCANEO) << ", "
+             << st_plan.plan_fuerza_bruta << " consultas por " << nombrePlan(PlanVentana::FUERZA_BRUTA) << endl;
+    }
+
     cout << "\n" << string(60, '=') << endl;
     cout << "\n[Interpretación]" << endl;
     cout << "- Recall: |R ∩ R*| / k (fracción de IDs que coinciden)" << endl;
@@ -500,5 +443,10 @@ int main(){
     cout << "- Valores cercanos a 1.0 (ratio) y 1.0 (recall) indican mejor calidad" << endl;
     cout << string(60, '=') << endl;
 
+    if(!ruta_traza.empty()) {
+        traza::exportarChrome(ruta_traza);
+        cout << "[Trazas guardadas en " << ruta_traza << "]" << endl;
+    }
+
     return 0;
 }
@@ -0,0 +1,102 @@
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include "DBLSH.h"
+#include <vector>
+#include <algorithm>
+#include <random>
+#include <filesystem>
+#include <chrono>
+
+using namespace std;
+using namespace std::chrono;
+
+vector<vector<double>> loadDataset(const string& path, size_t max_rows = 5000) {
+    ifstream f(path);
+    if (!f) throw runtime_error("No se pudo abrir " + path);
+
+    string line;
+    getline(f, line);
+    vector<vector<double>> datos;
+    datos.reserve(max_rows);
+
+    while (getline(f, line) && datos.size() < max_rows) {
+        stringstream ss(line);
+        string cell;
+        if (!getline(ss, cell, ',')) continue;
+
+        vector<double> row;
+        row.reserve(784);
+        while (getline(ss, cell, ',')) {
+            row.push_back(stod(cell));
+        }
+        if (row.size() == 784) datos.push_back(move(row));
+    }
+    return datos;
+}
+
+#define MAIN_C 1.5
+#define MAIN_K 83
+#define MAIN_L 2
+#define BENCH_QUERIES 50
+#define BENCH_KNN 50
+#define MAIN_D_FIJA 784  // Dimensión original fijada en compilación; 0 = en ejecución
+#define BENCH_REPETICIONES 3   // Se reporta la mejor de las repeticiones
+
+// Benchmark del prefetch de candidatos en la verificación: candidatos
+// verificados por segundo según la distancia de prefetch, para t = 500 y
+// t = 8000 y almacén double / uint8
+int main(){
+    std::filesystem::create_directories("results");
+
+    const int D = 784;
+    const int K = MAIN_K;
+    const double R_MIN = 1;
+
+    cout << "============================================================" << endl;
+    cout << "DB-LSH: Benchmark de prefetch en la verificación" << endl;
+    cout << "============================================================" << endl;
+
+    vector<vector<double>> full_dataset = loadDataset("fashion_mnist.csv", 60000);
+    mt19937 gen(42);
+    shuffle(full_dataset.begin(), full_dataset.end(), gen);
+    vector<vector<double>> queries(full_dataset.begin(), full_dataset.begin() + BENCH_QUERIES);
+    vector<vector<double>> dataset_index(full_dataset.begin() + BENCH_QUERIES, full_dataset.end());
+    full_dataset.clear();
+    cout << "Puntos indexados: " << dataset_index.size() << ", queries: " << queries.size() << endl;
+
+    ofstream csv_file("results/prefetch_results.csv");
+    csv_file << "formato,t,distancia,verificados,tiempo_ms,verificados_por_s\n";
+
+    vector<size_t> distancias = {0, 1, 2, 4, 8, 16};
+    for(FormatoPuntos formato : {FormatoPuntos::F64, FormatoPuntos::U8}) {
+        for(int t : {500, 8000}) {
+            DBLSH<K, MAIN_D_FIJA> indice(D, MAIN_L, MAIN_C, R_MIN, t, 42, FamiliaHash::GAUSSIANA, false);
+            indice.configurarAlmacen(formato);
+            indice.insertar(dataset_index);
+
+            cout << "\nAlmacén " << nombreFormato(formato) << ", t = " << t << endl;
+            cout << "distancia\tverificados/s\ttiempo (ms)" << endl;
+            for(size_t distancia : distancias) {
+                indice.configurarPrefetch(distancia);
+                double mejor_ms = 1e300;
+                size_t verificados = 0;
+                for(int rep = 0; rep < BENCH_REPETICIONES; rep++) {
+                    EstadisticasConsulta st;
+                    auto inicio = high_resolution_clock::now();
+                    for(const auto& q : queries) indice.C_ANN_K(q, MAIN_C, BENCH_KNN, &st);
+                    double ms = duration<double, milli>(high_resolution_clock::now() - inicio).count();
+                    mejor_ms = min(mejor_ms, ms);
+                    verificados = st.verificados;
+                }
+                double por_s = verificados / (mejor_ms / 1000.0);
+                cout << distancia << "\t\t" << por_s << "\t" << mejor_ms << endl;
+                csv_file << nombreFormato(formato) << "," << t << "," << distancia << ","
+                         << verificados << "," << mejor_ms << "," << por_s << "\n";
+            }
+        }
+    }
+    csv_file.close();
+    cout << "\n[Resultados guardados en results/prefetch_results.csv]" << endl;
+    return 0;
+}
@@ -0,0 +1,398 @@
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include "DBLSH.h"
+#include "versioned_index.h"
+#include "net_protocol.h"
+#include "thread_pool.h"
+#include <vector>
+#include <deque>
+#include <map>
+#include <set>
+#include <list>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <future>
+#include <atomic>
+#include <chrono>
+#include <random>
+#include <csignal>
+#include <cmath>
+
+using namespace std;
+using namespace std::chrono;
+
+vector<vector<double>> loadDataset(const string& path, size_t max_rows = 5000) {
+    ifstream f(path);
+    if (!f) throw runtime_error("No se pudo abrir " + path);
+
+    string line;
+    getline(f, line);
+    vector<vector<double>> datos;
+    datos.reserve(max_rows);
+
+    while (getline(f, line) && datos.size() < max_rows) {
+        stringstream ss(line);
+        string cell;
+        if (!getline(ss, cell, ',')) continue;
+
+        vector<double> row;
+        row.reserve(784);
+        while (getline(ss, cell, ',')) {
+            row.push_back(stod(cell));
+        }
+        if (row.size() == 784) datos.push_back(move(row));
+    }
+    return datos;
+}
+
+// Petición k-NN pendiente en la cola del servidor
+struct Peticion {
+    vector<double> query;
+    double c;
+    int k;
+    steady_clock::time_point llegada;
+    promise<vector<pair<int, double>>> respuesta;
+};
+
+// Cola de peticiones que se consumen en micro-lotes: se espera a la primera
+// petición y luego hasta `ventana` (o hasta llenar `max_lote`) para agrupar
+// las que lleguen concurrentemente
+class ColaLotes {
+    deque<shared_ptr<Peticion>> cola_;
+    mutex mtx_;
+    condition_variable cv_;
+    bool cerrada_ = false;
+    size_t maxima_ = 0;
+
+public:
+    void push(shared_ptr<Peticion> p) {
+        {
+            lock_guard<mutex> lock(mtx_);
+            cola_.push_back(move(p));
+            maxima_ = max(maxima_, cola_.size());
+        }
+        cv_.notify_one();
+    }
+
+    // Lote vacío = cola cerrada
+    vector<shared_ptr<Peticion>> popLote(size_t max_lote, microseconds ventana) {
+        unique_lock<mutex> lock(mtx_);
+        cv_.wait(lock, [this] { return cerrada_ || !cola_.empty(); });
+        if(cola_.empty()) return {};
+
+        auto limite = steady_clock::now() + ventana;
+        cv_.wait_until(lock, limite, [&] { return cerrada_ || cola_.size() >= max_lote; });
+
+        vector<shared_ptr<Peticion>> lote;
+        while(!cola_.empty() && lote.size() < max_lote) {
+            lote.push_back(move(cola_.front()));
+            cola_.pop_front();
+        }
+        return lote;
+    }
+
+    void cerrar() {
+        {
+            lock_guard<mutex> lock(mtx_);
+            cerrada_ = true;
+        }
+        cv_.notify_all();
+    }
+
+    size_t profundidad() {
+        lock_guard<mutex> lock(mtx_);
+        return cola_.size();
+    }
+
+    size_t profundidadMaxima() {
+        lock_guard<mutex> lock(mtx_);
+        return maxima_;
+    }
+};
+
+// Contadores del servidor (latencias de las últimas MUESTRAS peticiones)
+class Contadores {
+    static constexpr size_t MUESTRAS = 10000;
+    mutex mtx_;
+    uint64_t peticiones_ = 0;
+    uint64_t lotes_ = 0;
+    uint64_t parciales_ = 0;
+    double suma_latencia_us_ = 0.0;
+    vector<double> latencias_us_;
+    size_t siguiente_ = 0;
+
+public:
+    void registrarLote(const vector<double>& latencias_us, size_t parciales) {
+        lock_guard<mutex> lock(mtx_);
+        lotes_++;
+        parciales_ += parciales;
+        for(double lat : latencias_us) {
+            peticiones_++;
+            suma_latencia_us_ += lat;
+            if(latencias_us_.size() < MUESTRAS) latencias_us_.push_back(lat);
+            else latencias_us_[siguiente_++ % MUESTRAS] = lat;
+        }
+    }
+
+    protocolo::EstadisticasServidor snapshot() {
+        lock_guard<mutex> lock(mtx_);
+        protocolo::EstadisticasServidor st;
+        st.peticiones = peticiones_;
+        st.lotes = lotes_;
+        st.parciales = parciales_;
+        if(lotes_ > 0) st.lote_medio = static_cast<double>(peticiones_) / lotes_;
+        if(peticiones_ > 0) st.latencia_media_us = suma_latencia_us_ / peticiones_;
+        if(!latencias_us_.empty()) {
+            vector<double> orden = latencias_us_;
+            size_t p50 = orden.size() / 2;
+            size_t p99 = min(orden.size() - 1, orden.size() * 99 / 100);
+            nth_element(orden.begin(), orden.begin() + p50, orden.end());
+            st.latencia_p50_us = orden[p50];
+            nth_element(orden.begin(), orden.begin() + p99, orden.end());
+            st.latencia_p99_us = orden[p99];
+        }
+        return st;
+    }
+};
+
+#define MAIN_C 1.5
+#define MAIN_t 8000
+#define MAIN_K 83
+#define MAIN_L 2
+#define MAIN_FORMATO FormatoPuntos::U8
+#define SERVER_MAX_LOTE 32       // Consultas máximas por micro-lote
+#define SERVER_VENTANA_US 200    // Espera máxima para completar un micro-lote
+#define SERVER_PUBLICAR_MS 1000  // Cada cuánto se reconstruye el índice con los puntos insertados
+#define SERVER_PLAZO_MS 0        // Plazo por consulta en el índice (respuesta parcial al vencer); 0 = sin plazo
+
+int main(int argc, char** argv){
+    string direccion = argc > 1 ? argv[1] : "unix:/tmp/dblsh_server.sock";
+    string dataset = argc > 2 ? argv[2] : "fashion_mnist.csv";
+
+    const int D = 784;
+    const double C = MAIN_C;
+    const int t = MAIN_t;
+    const int K = MAIN_K;
+    const int L = MAIN_L;
+    const double R_MIN = 1;
+
+    signal(SIGPIPE, SIG_IGN);
+
+    cout << "============================================================" << endl;
+    cout << "DB-LSH: servidor de consultas k-NN" << endl;
+    cout << "============================================================" << endl;
+
+    cout << "Cargando " << dataset << "...\n";
+    vector<vector<double>> datos = loadDataset(dataset, 60000);
+    cout << "Filas cargadas: " << datos.size() << endl;
+
+    // Índice residente versionado: las inserciones van a un delta y se publican
+    // periódicamente sin bloquear las consultas
+    IndiceVersionado<K> indice(D, [&] {
+        auto nuevo = make_unique<DBLSH<K>>(D, L, C, R_MIN, t, 42, FamiliaHash::GAUSSIANA, false);
+        nuevo->configurarAlmacen(MAIN_FORMATO);
+        return nuevo;
+    });
+    indice.agregar(move(datos));
+    indice.publicar();
+    cout << "Índice construido: " << indice.size() << " puntos" << endl;
+
+    ThreadPool pool;
+    LimitesConsulta limites;
+    limites.tiempo_ms = SERVER_PLAZO_MS;
+    ColaLotes cola;
+    Contadores contadores;
+    atomic<bool> activo(true);
+    int fd_escucha = protocolo::escuchar(direccion);
+
+    // Hilo de lotes: agrupa peticiones concurrentes y las ejecuta con el
+    // camino por lotes (proyección conjunta + búsquedas en paralelo)
+    thread hilo_lotes([&] {
+        while(true) {
+            auto lote = cola.popLote(SERVER_MAX_LOTE, microseconds(SERVER_VENTANA_US));
+            if(lote.empty()) return;
+
+            // Agrupar por (c, k): C_ANN_K_lote usa los mismos parámetros para todo el lote
+            map<pair<double, int>, vector<shared_ptr<Peticion>>> grupos;
+            for(auto& p : lote) grupos[{p->c, p->k}].push_back(p);
+
+            vector<double> latencias_us;
+            size_t parciales = 0;
+            for(auto& [params, peticiones] : grupos) {
+                vector<vector<double>> queries;
+                for(auto& p : peticiones) queries.push_back(move(p->query));
+                try {
+                    vector<EstadisticasConsulta> estadisticas;
+                    auto resultados = indice.C_ANN_K_lote(queries, params.first, params.second, pool, limites, &estadisticas);
+                    for(const auto& e : estadisticas) parciales += e.parciales;
+                    for(size_t b = 0; b < peticiones.size(); b++) {
+                        vector<pair<int, double>> vecinos;
+                        for(const auto& v : resultados[b]) vecinos.push_back({get<0>(v), get<2>(v)});
+                        latencias_us.push_back(duration<double, micro>(steady_clock::now() - peticiones[b]->llegada).count());
+                        peticiones[b]->respuesta.set_value(move(vecinos));
+                    }
+                } catch(...) {
+                    for(auto& p : peticiones) p->respuesta.set_exception(current_exception());
+                }
+            }
+            contadores.registrarLote(latencias_us, parciales);
+        }
+    });
+
+    // Hilo de publicación: reconstruye el base con el delta acumulado
+    mutex mtx_publicacion;
+    condition_variable cv_publicacion;
+    thread hilo_publicacion([&] {
+        unique_lock<mutex> lock(mtx_publicacion);
+        while(activo) {
+            cv_publicacion.wait_for(lock, milliseconds(SERVER_PUBLICAR_MS), [&] { return !activo; });
+            if(!activo || indice.pendientes() == 0) continue;
+            lock.unlock();
+            try {
+                auto t0 = steady_clock::now();
+                size_t n = indice.publicar();
+                cout << "Publicada versión " << indice.version() << " (" << n << " puntos indexados, "
+                     << duration<double>(steady_clock::now() - t0).count() << " s)" << endl;
+            } catch(const exception& e) {
+                cerr << "Publicación: " << e.what() << endl;
+            }
+            lock.lock();
+        }
+    });
+
+    mutex mtx_conexiones;
+    set<int> abiertas;
+
+    // Validación por petición antes de encolarla: un lote agrupa peticiones
+    // de varios clientes y un error en C_ANN_K_lote fallaría a todo el grupo
+    auto validarPeticion = [&](const Peticion& p) -> string {
+        if(static_cast<int>(p.query.size()) != D) return "Query debe tener " + to_string(D) + " dimensiones";
+        for(double x : p.query) {
+            if(!isfinite(x)) return "Query con coordenadas no finitas";
+        }
+        if(p.k <= 0) return "k debe ser positivo";
+        if(!(p.c > 1) || !isfinite(p.c)) return "c debe ser finito y mayor que 1";
+        return "";
+    };
+
+    // Una conexión = un hilo que lee peticiones y espera sus respuestas
+    auto atender = [&](int fd) {
+        protocolo::Mensaje m;
+        try {
+            while(protocolo::recibir(fd, m)) {
+                if(m.tipo == protocolo::CONSULTA_KNN) {
+                    auto p = make_shared<Peticion>();
+                    protocolo::decodificarConsulta(m.datos, p->query, p->c, p->k);
+                    string invalida = validarPeticion(*p);
+                    if(!invalida.empty()) {
+                        protocolo::enviar(fd, protocolo::ERROR, vector<char>(invalida.begin(), invalida.end()));
+                        continue;
+                    }
+                    p->llegada = steady_clock::now();
+                    auto futuro = p->respuesta.get_future();
+                    cola.push(p);
+                    try {
+                        protocolo::enviar(fd, protocolo::RESPUESTA_KNN, protocolo::codificarRespuesta(futuro.get()));
+                    } catch(const runtime_error& e) {
+                        string msg = e.what();
+                        protocolo::enviar(fd, protocolo::ERROR, vector<char>(msg.begin(), msg.end()));
+                    }
+                } else if(m.tipo == protocolo::INSERTAR) {
+                    try {
+                        int32_t primer_id = indice.agregar(protocolo::decodificarInsercion(m.datos));
+                        protocolo::Escritor e;
+                        e.put(primer_id);
+                        protocolo::enviar(fd, protocolo::INSERTAR, e.datos());
+                    } catch(const runtime_error& e) {
+                        string msg = e.what();
+                        protocolo::enviar(fd, protocolo::ERROR, vector<char>(msg.begin(), msg.end()));
+                    }
+                } else if(m.tipo == protocolo::ESTADISTICAS) {
+                    auto st = contadores.snapshot();
+                    st.cola_actual = cola.profundidad();
+                    st.cola_maxima = cola.profundidadMaxima();
+                    st.version = indice.version();
+                    st.puntos = indice.size();
+                    st.puntos_delta = indice.pendientes();
+                    protocolo::enviar(fd, protocolo::ESTADISTICAS, protocolo::codificarEstadisticas(st));
+                } else if(m.tipo == protocolo::FIN) {
+                    {
+                        lock_guard<mutex> lock(mtx_publicacion);
+                        activo = false;
+                    }
+                    cv_publicacion.notify_all();
+                    ::shutdown(fd_escucha, SHUT_RDWR);
+                    break;
+                }
+            }
+        } catch(const exception& e) {
+            cerr << "Conexión: " << e.what() << endl;
+        }
+        lock_guard<mutex> lock(mtx_conexiones);
+        abiertas.erase(fd);
+        ::close(fd);
+    };
+
+    cout << "Escuchando en " << direccion << " (lote máx. " << SERVER_MAX_LOTE
+         << ", ventana " << SERVER_VENTANA_US << " us, " << pool.size() << " hilos)" << endl;
+
+    // Hilos de conexión con su marca de fin: los terminados se recogen en
+    // cada accept para no acumular un hilo por conexión atendida
+    struct Conexion {
+        thread hilo;
+        shared_ptr<atomic<bool>> terminada;
+    };
+    list<Conexion> conexiones;
+    auto recoger = [&] {
+        for(auto it = conexiones.begin(); it != conexiones.end();) {
+            if(*it->terminada) {
+                it->hilo.join();
+                it = conexiones.erase(it);
+            } else {
+                ++it;
+            }
+        }
+    };
+    while(activo) {
+        int fd = ::accept(fd_escucha, nullptr, nullptr);
+        if(fd < 0) {
+            if(!activo) break;
+            continue;
+        }
+        recoger();
+        auto terminada = make_shared<atomic<bool>>(false);
+        lock_guard<mutex> lock(mtx_conexiones);
+        abiertas.insert(fd);
+        conexiones.push_back({thread([&atender, fd, terminada] {
+            atender(fd);
+            *terminada = true;
+        }), terminada});
+    }
+
+    // Cortar las conexiones que sigan abiertas para que sus hilos terminen
+    {
+        lock_guard<mutex> lock(mtx_conexiones);
+        for(int fd : abiertas) ::shutdown(fd, SHUT_RDWR);
+    }
+    for(auto& c : conexiones) c.hilo.join();
+    cola.cerrar();
+    hilo_lotes.join();
+    hilo_publicacion.join();
+    ::close(fd_escucha);
+    if(direccion.rfind("unix:", 0) == 0) ::unlink(direccion.substr(5).c_str());
+
+    auto st = contadores.snapshot();
+    cout << "\nServidor detenido." << endl;
+    cout << "  Peticiones: " << st.peticiones << " en " << st.lotes << " lotes (media "
+         << st.lote_medio << " por lote)" << endl;
+    cout << "  Cola máxima: " << cola.profundidadMaxima() << endl;
+    cout << "  Latencia: media " << st.latencia_media_us << " us, p50 " << st.latencia_p50_us
+         << " us, p99 " << st.latencia_p99_us << " us" << endl;
+    if(SERVER_PLAZO_MS > 0) cout << "  Respuestas parciales (plazo " << SERVER_PLAZO_MS << " ms): " << st.parciales << endl;
+    cout << "  Índice: versión " << indice.version() << ", " << indice.size() << " puntos ("
+         << indice.pendientes() << " sin publicar)" << endl;
+    return 0;
+}
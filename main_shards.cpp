@@ -0,0 +1,188 @@
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include "DBLSH.h"
+#include "shard.h"
+#include "coordinator.h"
+#include <vector>
+#include <tuple>
+#include <cmath>
+#include <algorithm>
+#include <random>
+#include <set>
+#include <filesystem>
+#include <chrono>
+#include <sys/wait.h>
+
+using namespace std;
+using namespace std::chrono;
+
+vector<vector<double>> loadDataset(const string& path, size_t max_rows = 5000) {
+    ifstream f(path);
+    if (!f) throw runtime_error("No se pudo abrir " + path);
+
+    string line;
+    getline(f, line);
+    vector<vector<double>> datos;
+    datos.reserve(max_rows);
+
+    while (getline(f, line) && datos.size() < max_rows) {
+        stringstream ss(line);
+        string cell;
+        if (!getline(ss, cell, ',')) continue;
+
+        vector<double> row;
+        row.reserve(784);
+        while (getline(ss, cell, ',')) {
+            row.push_back(stod(cell));
+        }
+        if (row.size() == 784) datos.push_back(move(row));
+    }
+    return datos;
+}
+
+// Métricas (ids globales)
+double calcularRecall(const vector<pair<int, double>>& vecinos, const vector<pair<int, double>>& reales) {
+    if(vecinos.empty() || reales.empty()) return 0.0;
+    set<int> ids_reales;
+    for(const auto& v : reales) ids_reales.insert(v.first);
+    int interseccion = 0;
+    for(const auto& v : vecinos) {
+        if(ids_reales.count(v.first)) interseccion++;
+    }
+    return (double)interseccion / ids_reales.size();
+}
+
+double calcularOverallRatio(const vector<pair<int, double>>& vecinos, const vector<pair<int, double>>& reales) {
+    if(vecinos.empty() || reales.empty()) return 1.0;
+    double sum_ratios = 0.0;
+    int n = min(vecinos.size(), reales.size());
+    for(int i = 0; i < n; i++) {
+        if(reales[i].second > 1e-9) sum_ratios += vecinos[i].second / reales[i].second;
+    }
+    return sum_ratios / n;
+}
+
+// Ground truth por fuerza bruta sobre el dataset completo
+vector<pair<int, double>> kVecinosReales(const PointStore& datos, const vector<double>& query, int k) {
+    PointStore::Consulta consulta = datos.preparar(query);
+    vector<pair<int, double>> distancias(datos.size());
+    for(size_t i = 0; i < datos.size(); i++) distancias[i] = {static_cast<int>(i), datos.distancia(consulta, i)};
+    int top = min(k, (int)distancias.size());
+    partial_sort(distancias.begin(), distancias.begin() + top, distancias.end(),
+                 [](const auto& a, const auto& b) { return a.second < b.second; });
+    distancias.resize(top);
+    return distancias;
+}
+
+#define MAIN_C 1.5
+#define MAIN_t 8000
+#define MAIN_K 83
+#define MAIN_L 2
+#define MAIN_SHARDS 4
+#define MAIN_FORMATO FormatoPuntos::U8
+
+int main(){
+    std::filesystem::create_directories("results");
+
+    cout << "============================================================" << endl;
+    cout << "DB-LSH distribuido: scatter-gather sobre shards locales" << endl;
+    cout << "============================================================" << endl;
+
+    const int D = 784;
+    const double C = MAIN_C;
+    const int t = MAIN_t;
+    const int K = MAIN_K;
+    const int L = MAIN_L;
+    const int N_SHARDS = MAIN_SHARDS;
+    const int K_QUERIES = 50;
+    const int K_NN = 50;
+    const double R_MIN = 1;
+
+    cout << "Cargando Fashion-MNIST completo...\n";
+    vector<vector<double>> full_dataset = loadDataset("fashion_mnist.csv", 60000);
+    cout << "Total cargado: " << full_dataset.size() << " imágenes" << endl;
+
+    mt19937 gen(42);
+    shuffle(full_dataset.begin(), full_dataset.end(), gen);
+
+    vector<vector<double>> queries(full_dataset.begin(), full_dataset.begin() + K_QUERIES);
+    vector<vector<double>> dataset_index(full_dataset.begin() + K_QUERIES, full_dataset.end());
+    full_dataset.clear();
+    full_dataset.shrink_to_fit();
+
+    // Lanzar un proceso por shard (misma semilla => mismas funciones hash)
+    vector<string> rutas;
+    vector<pid_t> hijos;
+    for(int s = 0; s < N_SHARDS; s++) {
+        rutas.push_back("/tmp/dblsh_shard_" + to_string(getpid()) + "_" + to_string(s) + ".sock");
+    }
+
+    for(int s = 0; s < N_SHARDS; s++) {
+        pid_t pid = fork();
+        if(pid < 0) throw runtime_error("fork() falló");
+        if(pid == 0) {
+            vector<vector<double>> parte;
+            vector<int> ids_globales;
+            particionarDataset(dataset_index, s, N_SHARDS, parte, ids_globales);
+            dataset_index.clear();
+            dataset_index.shrink_to_fit();
+
+            DBLSH<K> indice(D, L, C, R_MIN, t, 42, FamiliaHash::GAUSSIANA, false);
+            indice.configurarAlmacen(MAIN_FORMATO);
+            indice.insertar(parte);
+            parte.clear();
+            parte.shrink_to_fit();
+
+            servirShard(indice, ids_globales, rutas[s]);
+            _exit(0);
+        }
+        hijos.push_back(pid);
+    }
+
+    cout << "Shards: " << N_SHARDS << " procesos (" << dataset_index.size() / N_SHARDS
+         << " puntos c/u aprox.)" << endl;
+
+    PointStore ground_truth;
+    ground_truth.asignar(dataset_index, D, MAIN_FORMATO);
+    dataset_index.clear();
+    dataset_index.shrink_to_fit();
+
+    cout << "Conectando coordinador..." << flush;
+    CoordinadorShards coordinador(rutas);
+    cout << " OK" << endl;
+
+    double total_recall = 0.0, total_ratio = 0.0, total_time_ms = 0.0;
+    cout << "Ejecutando " << K_QUERIES << " queries (k = " << K_NN << ")..." << flush;
+    for(int q = 0; q < K_QUERIES; q++) {
+        auto start = high_resolution_clock::now();
+        auto vecinos = coordinador.C_ANN_K(queries[q], C, K_NN);
+        auto end = high_resolution_clock::now();
+
+        auto reales = kVecinosReales(ground_truth, queries[q], K_NN);
+        total_recall += calcularRecall(vecinos, reales);
+        total_ratio += calcularOverallRatio(vecinos, reales);
+        total_time_ms += duration_cast<microseconds>(end - start).count() / 1000.0;
+    }
+    cout << " OK" << endl;
+
+    coordinador.detener();
+    for(pid_t pid : hijos) waitpid(pid, nullptr, 0);
+
+    double avg_recall = total_recall / K_QUERIES;
+    double avg_ratio = total_ratio / K_QUERIES;
+    double avg_time_ms = total_time_ms / K_QUERIES;
+
+    cout << "  Resultados promedio:" << endl;
+    cout << "    Recall: " << (avg_recall * 100) << "%" << endl;
+    cout << "    Ratio: " << avg_ratio << "x" << endl;
+    cout << "    Query time: " << avg_time_ms << " ms" << endl;
+
+    ofstream csv_file("results/shards_results.csv");
+    csv_file << "shards,recall,overall_ratio,avg_time_ms\n";
+    csv_file << N_SHARDS << "," << avg_recall << "," << avg_ratio << "," << avg_time_ms << "\n";
+    csv_file.close();
+
+    cout << "\nResultados guardados en: results/shards_results.csv" << endl;
+    return 0;
+}
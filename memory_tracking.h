@@ -0,0 +1,76 @@
+#ifndef MEMORY_TRACKING_H
+#define MEMORY_TRACKING_H
+
+#include <atomic>
+#include <memory>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+
+using namespace std;
+
+// Contador de bytes vivos y pico de un componente
+struct ContadorMemoria {
+    atomic<int64_t> actual{0};
+    atomic<int64_t> pico{0};
+
+    void sumar(size_t bytes) {
+        int64_t ahora = actual.fetch_add(static_cast<int64_t>(bytes)) + static_cast<int64_t>(bytes);
+        int64_t p = pico.load();
+        while(ahora > p && !pico.compare_exchange_weak(p, ahora)) {}
+    }
+
+    void restar(size_t bytes) {
+        actual.fetch_sub(static_cast<int64_t>(bytes));
+    }
+
+    void reiniciarPico() {
+        pico.store(actual.load());
+    }
+};
+
+// Allocator que anota cada reserva/liberación en un ContadorMemoria compartido.
+// Las copias (y rebinds, p.ej. los nodos internos del R*-tree) comparten contador
+template <typename T>
+class TrackingAllocator {
+public:
+    using value_type = T;
+
+    shared_ptr<ContadorMemoria> contador;
+
+    TrackingAllocator() : contador(make_shared<ContadorMemoria>()) {}
+    explicit TrackingAllocator(shared_ptr<ContadorMemoria> c) : contador(move(c)) {}
+
+    template <typename U>
+    TrackingAllocator(const TrackingAllocator<U>& otro) : contador(otro.contador) {}
+
+    T* allocate(size_t n) {
+        T* p = static_cast<T*>(::operator new(n * sizeof(T)));
+        contador->sumar(n * sizeof(T));
+        return p;
+    }
+
+    void deallocate(T* p, size_t n) {
+        contador->restar(n * sizeof(T));
+        ::operator delete(p);
+    }
+
+    template <typename U>
+    struct rebind { using other = TrackingAllocator<U>; };
+
+    using propagate_on_container_copy_assignment = true_type;
+    using propagate_on_container_move_assignment = true_type;
+    using propagate_on_container_swap = true_type;
+};
+
+template <typename T, typename U>
+bool operator==(const TrackingAllocator<T>& a, const TrackingAllocator<U>& b) {
+    return a.contador == b.contador;
+}
+
+template <typename T, typename U>
+bool operator!=(const TrackingAllocator<T>& a, const TrackingAllocator<U>& b) {
+    return !(a == b);
+}
+
+#endif // MEMORY_TRACKING_H
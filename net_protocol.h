@@ -0,0 +1,341 @@
+#ifndef NET_PROTOCOL_H
+#define NET_PROTOCOL_H
+
+#include <vector>
+#include <string>
+#include <cstring>
+#include <cstdint>
+#include <stdexcept>
+#include <cerrno>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+
+using namespace std;
+
+// Protocolo binario compacto sobre sockets de flujo (Unix o TCP).
+// Cada mensaje: cabecera {uint32 tipo, uint32 bytes} + payload.
+// Los enteros y doubles van en el orden de bytes nativo (uso local).
+namespace protocolo {
+
+enum TipoMensaje : uint32_t {
+    CONSULTA_KNN = 1,   // int32 k, double c, uint32 D, D doubles
+    RESPUESTA_KNN = 2,  // uint32 n, n × {int32 id, double dist}
+    FIN = 3,            // Cerrar la conexión / detener el servidor
+    ERROR = 4,          // Texto del error
+    ESTADISTICAS = 5,   // Petición vacía; respuesta con EstadisticasServidor
+    INSERTAR = 6        // uint32 n, uint32 D, n×D doubles; respuesta: int32 primer id
+};
+
+// Contadores que reporta el servidor de consultas
+struct EstadisticasServidor {
+    uint64_t peticiones = 0;        // Consultas k-NN atendidas
+    uint64_t lotes = 0;             // Micro-lotes ejecutados
+    uint64_t cola_actual = 0;       // Profundidad de la cola al pedir estadísticas
+    uint64_t cola_maxima = 0;
+    double lote_medio = 0.0;        // Consultas por micro-lote
+    double latencia_media_us = 0.0; // Desde llegada a la cola hasta respuesta lista
+    double latencia_p50_us = 0.0;
+    double latencia_p99_us = 0.0;
+    uint64_t version = 0;           // Versión del índice (cambia con cada lote y publicación)
+    uint64_t puntos = 0;            // Puntos totales (indexados + delta)
+    uint64_t puntos_delta = 0;      // Puntos pendientes de publicar
+    uint64_t parciales = 0;         // Consultas cortadas por el plazo (respuesta parcial)
+};
+
+// Payload máximo que acepta recibir(): una cabecera corrupta o maliciosa no
+// puede hacer reservar más que esto (un INSERTAR de 10k puntos de 784D son 63 MB)
+constexpr uint32_t MAX_BYTES_MENSAJE = 256u << 20;
+
+struct Mensaje {
+    uint32_t tipo = 0;
+    vector<char> datos;
+};
+
+// Serialización de campos POD en un buffer
+class Escritor {
+    vector<char> buf_;
+public:
+    template <typename T>
+    void put(const T& v) {
+        const char* p = reinterpret_cast<const char*>(&v);
+        buf_.insert(buf_.end(), p, p + sizeof(T));
+    }
+    template <typename T>
+    void putArray(const T* v, size_t n) {
+        const char* p = reinterpret_cast<const char*>(v);
+        buf_.insert(buf_.end(), p, p + n * sizeof(T));
+    }
+    vector<char>& datos() { return buf_; }
+};
+
+class Lector {
+    const vector<char>& buf_;
+    size_t pos_;
+public:
+    explicit Lector(const vector<char>& buf) : buf_(buf), pos_(0) {}
+    template <typename T>
+    T get() {
+        T v;
+        getArray(&v, 1);
+        return v;
+    }
+    template <typename T>
+    void getArray(T* v, size_t n) {
+        if(pos_ + n * sizeof(T) > buf_.size()) throw runtime_error("Mensaje truncado");
+        memcpy(v, buf_.data() + pos_, n * sizeof(T));
+        pos_ += n * sizeof(T);
+    }
+    size_t restantes() const { return buf_.size() - pos_; }
+};
+
+inline void escribirTodo(int fd, const void* data, size_t n) {
+    const char* p = static_cast<const char*>(data);
+    while(n > 0) {
+        ssize_t w = ::send(fd, p, n, MSG_NOSIGNAL);
+        if(w < 0 && errno == EINTR) continue;
+        if(w <= 0) throw runtime_error(string("Error escribiendo en socket: ") + strerror(errno));
+        p += w;
+        n -= static_cast<size_t>(w);
+    }
+}
+
+// Retorna false si el otro extremo cerró la conexión antes del primer byte
+inline bool leerTodo(int fd, void* data, size_t n) {
+    char* p = static_cast<char*>(data);
+    size_t leidos = 0;
+    while(leidos < n) {
+        ssize_t r = ::recv(fd, p + leidos, n - leidos, 0);
+        if(r < 0 && errno == EINTR) continue;
+        if(r < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) throw runtime_error("Tiempo de espera agotado en el socket");
+        if(r == 0 && leidos == 0) return false;
+        if(r <= 0) throw runtime_error("Conexión cerrada a mitad de mensaje");
+        leidos += static_cast<size_t>(r);
+    }
+    return true;
+}
+
+// Plazo de recv() en el socket (0 = sin plazo): al vencer, recibir() lanza
+inline void plazoRecepcion(int fd, int ms) {
+    timeval tv;
+    tv.tv_sec = ms / 1000;
+    tv.tv_usec = (ms % 1000) * 1000;
+    if(::setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv)) < 0) {
+        throw runtime_error(string("No se pudo fijar el plazo del socket: ") + strerror(errno));
+    }
+}
+
+inline void enviar(int fd, uint32_t tipo, const vector<char>& datos) {
+    uint32_t cabecera[2] = {tipo, static_cast<uint32_t>(datos.size())};
+    escribirTodo(fd, cabecera, sizeof(cabecera));
+    if(!datos.empty()) escribirTodo(fd, datos.data(), datos.size());
+}
+
+inline bool recibir(int fd, Mensaje& m) {
+    uint32_t cabecera[2];
+    if(!leerTodo(fd, cabecera, sizeof(cabecera))) return false;
+    if(cabecera[1] > MAX_BYTES_MENSAJE) {
+        throw runtime_error("Mensaje de " + to_string(cabecera[1]) + " bytes (máximo " + to_string(MAX_BYTES_MENSAJE) + ")");
+    }
+    m.tipo = cabecera[0];
+    m.datos.resize(cabecera[1]);
+    if(cabecera[1] > 0 && !leerTodo(fd, m.datos.data(), m.datos.size())) {
+        throw runtime_error("Conexión cerrada a mitad de mensaje");
+    }
+    return true;
+}
+
+// ---- Mensajes k-NN ----
+
+inline vector<char> codificarConsulta(const vector<double>& query, double c, int k) {
+    Escritor e;
+    e.put<int32_t>(k);
+    e.put<double>(c);
+    e.put<uint32_t>(static_cast<uint32_t>(query.size()));
+    e.putArray(query.data(), query.size());
+    return move(e.datos());
+}
+
+inline void decodificarConsulta(const vector<char>& datos, vector<double>& query, double& c, int& k) {
+    Lector l(datos);
+    k = l.get<int32_t>();
+    c = l.get<double>();
+    uint32_t D = l.get<uint32_t>();
+    if(static_cast<size_t>(D) * sizeof(double) != l.restantes()) throw runtime_error("Consulta con tamaño inconsistente");
+    query.resize(D);
+    l.getArray(query.data(), D);
+}
+
+inline vector<char> codificarRespuesta(const vector<pair<int, double>>& vecinos) {
+    Escritor e;
+    e.put<uint32_t>(static_cast<uint32_t>(vecinos.size()));
+    for(const auto& v : vecinos) {
+        e.put<int32_t>(v.first);
+        e.put<double>(v.second);
+    }
+    return move(e.datos());
+}
+
+inline vector<pair<int, double>> decodificarRespuesta(const vector<char>& datos) {
+    Lector l(datos);
+    uint32_t n = l.get<uint32_t>();
+    if(static_cast<size_t>(n) * (sizeof(int32_t) + sizeof(double)) != l.restantes()) throw runtime_error("Respuesta con tamaño inconsistente");
+    vector<pair<int, double>> vecinos(n);
+    for(auto& v : vecinos) {
+        v.first = l.get<int32_t>();
+        v.second = l.get<double>();
+    }
+    return vecinos;
+}
+
+inline vector<char> codificarInsercion(const vector<vector<double>>& puntos) {
+    Escritor e;
+    e.put<uint32_t>(static_cast<uint32_t>(puntos.size()));
+    e.put<uint32_t>(puntos.empty() ? 0 : static_cast<uint32_t>(puntos[0].size()));
+    for(const auto& p : puntos) e.putArray(p.data(), p.size());
+    return move(e.datos());
+}
+
+inline vector<vector<double>> decodificarInsercion(const vector<char>& datos) {
+    Lector l(datos);
+    uint32_t n = l.get<uint32_t>();
+    uint32_t D = l.get<uint32_t>();
+    // Validar n y D contra el payload antes de reservar nada
+    if(D == 0 || static_cast<size_t>(n) * D * sizeof(double) != l.restantes()) {
+        throw runtime_error("Inserción con tamaño inconsistente (n = " + to_string(n) + ", D = " + to_string(D) + ")");
+    }
+    vector<vector<double>> puntos(n, vector<double>(D));
+    for(auto& p : puntos) l.getArray(p.data(), D);
+    return puntos;
+}
+
+inline vector<char> codificarEstadisticas(const EstadisticasServidor& st) {
+    Escritor e;
+    e.put(st.peticiones);
+    e.put(st.lotes);
+    e.put(st.cola_actual);
+    e.put(st.cola_maxima);
+    e.put(st.lote_medio);
+    e.put(st.latencia_media_us);
+    e.put(st.latencia_p50_us);
+    e.put(st.latencia_p99_us);
+    e.put(st.version);
+    e.put(st.puntos);
+    e.put(st.puntos_delta);
+    e.put(st.parciales);
+    return move(e.datos());
+}
+
+inline EstadisticasServidor decodificarEstadisticas(const vector<char>& datos) {
+    Lector l(datos);
+    EstadisticasServidor st;
+    st.peticiones = l.get<uint64_t>();
+    st.lotes = l.get<uint64_t>();
+    st.cola_actual = l.get<uint64_t>();
+    st.cola_maxima = l.get<uint64_t>();
+    st.lote_medio = l.get<double>();
+    st.latencia_media_us = l.get<double>();
+    st.latencia_p50_us = l.get<double>();
+    st.latencia_p99_us = l.get<double>();
+    st.version = l.get<uint64_t>();
+    st.puntos = l.get<uint64_t>();
+    st.puntos_delta = l.get<uint64_t>();
+    st.parciales = l.get<uint64_t>();
+    return st;
+}
+
+// ---- Sockets Unix ----
+
+inline sockaddr_un direccionUnix(const string& ruta) {
+    sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if(ruta.size() >= sizeof(addr.sun_path)) throw runtime_error("Ruta de socket demasiado larga: " + ruta);
+    strncpy(addr.sun_path, ruta.c_str(), sizeof(addr.sun_path) - 1);
+    return addr;
+}
+
+inline int escucharUnix(const string& ruta, int backlog = 64) {
+    int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    if(fd < 0) throw runtime_error("No se pudo crear socket Unix");
+    ::unlink(ruta.c_str());
+    sockaddr_un addr = direccionUnix(ruta);
+    if(::bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0 || ::listen(fd, backlog) < 0) {
+        ::close(fd);
+        throw runtime_error("No se pudo escuchar en " + ruta + ": " + strerror(errno));
+    }
+    return fd;
+}
+
+// Conectar reintentando mientras el servidor arranca
+inline int conectarUnix(const string& ruta, int reintentos = 600) {
+    sockaddr_un addr = direccionUnix(ruta);
+    for(int i = 0; i <= reintentos; i++) {
+        int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+        if(fd < 0) throw runtime_error("No se pudo crear socket Unix");
+        if(::connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) == 0) return fd;
+        ::close(fd);
+        ::usleep(100000);
+    }
+    throw runtime_error("No se pudo conectar a " + ruta);
+}
+
+// ---- Sockets TCP (solo localhost) ----
+
+inline int escucharTCP(uint16_t puerto, int backlog = 64) {
+    int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+    if(fd < 0) throw runtime_error("No se pudo crear socket TCP");
+    int uno = 1;
+    ::setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &uno, sizeof(uno));
+    sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(puerto);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if(::bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0 || ::listen(fd, backlog) < 0) {
+        ::close(fd);
+        throw runtime_error("No se pudo escuchar en 127.0.0.1:" + to_string(puerto) + ": " + strerror(errno));
+    }
+    return fd;
+}
+
+inline int conectarTCP(uint16_t puerto, int reintentos = 600) {
+    sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(puerto);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    for(int i = 0; i <= reintentos; i++) {
+        int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+        if(fd < 0) throw runtime_error("No se pudo crear socket TCP");
+        if(::connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) == 0) {
+            int uno = 1;
+            ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &uno, sizeof(uno));
+            return fd;
+        }
+        ::close(fd);
+        ::usleep(100000);
+    }
+    throw runtime_error("No se pudo conectar a 127.0.0.1:" + to_string(puerto));
+}
+
+// Dirección "unix:/ruta" o "tcp:puerto"
+inline int escuchar(const string& direccion) {
+    if(direccion.rfind("tcp:", 0) == 0) return escucharTCP(static_cast<uint16_t>(stoi(direccion.substr(4))));
+    if(direccion.rfind("unix:", 0) == 0) return escucharUnix(direccion.substr(5));
+    throw runtime_error("Dirección inválida (usar unix:/ruta o tcp:puerto): " + direccion);
+}
+
+inline int conectar(const string& direccion) {
+    if(direccion.rfind("tcp:", 0) == 0) return conectarTCP(static_cast<uint16_t>(stoi(direccion.substr(4))));
+    if(direccion.rfind("unix:", 0) == 0) return conectarUnix(direccion.substr(5));
+    throw runtime_error("Dirección inválida (usar unix:/ruta o tcp:puerto): " + direccion);
+}
+
+} // namespace protocolo
+
+#endif // NET_PROTOCOL_H
@@ -0,0 +1,113 @@
+#ifndef PERF_COUNTERS_H
+#define PERF_COUNTERS_H
+
+#include <array>
+#include <string>
+#include <cstring>
+#include <cstdint>
+#include <cerrno>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+
+using namespace std;
+
+// Contadores hardware de Linux (perf_event_open) para el hilo actual, solo
+// espacio de usuario. Cada contador se abre por separado: si el kernel o la
+// CPU no ofrecen alguno (contenedores, VMs, perf_event_paranoid alto) queda
+// marcado como no disponible y el resto sigue funcionando.
+class ContadoresHW {
+public:
+    enum Contador { CICLOS, INSTRUCCIONES, LLC_MISSES, DTLB_MISSES, BRANCH_MISSES, NUM_CONTADORES };
+
+    struct Lectura {
+        array<uint64_t, NUM_CONTADORES> valores{};
+        array<bool, NUM_CONTADORES> validos{};
+
+        Lectura& operator+=(const Lectura& o) {
+            for(size_t i = 0; i < NUM_CONTADORES; i++) {
+                valores[i] += o.valores[i];
+                validos[i] = validos[i] || o.validos[i];
+            }
+            return *this;
+        }
+    };
+
+    static const char* nombre(size_t i) {
+        static const char* nombres[] = {"cycles", "instructions", "llc_misses", "dtlb_misses", "branch_misses"};
+        return nombres[i];
+    }
+
+private:
+    array<int, NUM_CONTADORES> fds_;
+    string error_;
+
+    static int abrir(uint32_t tipo, uint64_t config) {
+        perf_event_attr attr;
+        memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = tipo;
+        attr.config = config;
+        attr.disabled = 1;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        return static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+    }
+
+    static uint64_t configCache(uint64_t cache, uint64_t op, uint64_t resultado) {
+        return cache | (op << 8) | (resultado << 16);
+    }
+
+public:
+    ContadoresHW() {
+        fds_.fill(-1);
+        fds_[CICLOS] = abrir(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES);
+        fds_[INSTRUCCIONES] = abrir(PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS);
+        fds_[LLC_MISSES] = abrir(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES);
+        fds_[DTLB_MISSES] = abrir(PERF_TYPE_HW_CACHE, configCache(PERF_COUNT_HW_CACHE_DTLB, PERF_COUNT_HW_CACHE_OP_READ,
+                                                                  PERF_COUNT_HW_CACHE_RESULT_MISS));
+        fds_[BRANCH_MISSES] = abrir(PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES);
+        if(!disponible()) error_ = strerror(errno);
+    }
+
+    ~ContadoresHW() {
+        for(int fd : fds_) if(fd >= 0) ::close(fd);
+    }
+
+    ContadoresHW(const ContadoresHW&) = delete;
+    ContadoresHW& operator=(const ContadoresHW&) = delete;
+
+    // true si al menos un contador se pudo abrir
+    bool disponible() const {
+        for(int fd : fds_) if(fd >= 0) return true;
+        return false;
+    }
+
+    // Motivo por el que no hay contadores (vacío si disponible)
+    const string& error() const { return error_; }
+
+    void iniciar() {
+        for(int fd : fds_) {
+            if(fd < 0) continue;
+            ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+            ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+        }
+    }
+
+    Lectura detener() {
+        Lectura l;
+        for(size_t i = 0; i < NUM_CONTADORES; i++) {
+            if(fds_[i] < 0) continue;
+            ioctl(fds_[i], PERF_EVENT_IOC_DISABLE, 0);
+            uint64_t valor = 0;
+            if(::read(fds_[i], &valor, sizeof(valor)) == static_cast<ssize_t>(sizeof(valor))) {
+                l.valores[i] = valor;
+                l.validos[i] = true;
+            }
+        }
+        return l;
+    }
+};
+
+#endif // PERF_COUNTERS_H
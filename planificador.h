@@ -0,0 +1,237 @@
+#ifndef PLANIFICADOR_H
+#define PLANIFICADOR_H
+
+#include <vector>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <algorithm>
+#include "kernels.h"
+
+using namespace std;
+
+// Cómo se obtienen los puntos de una ventana (o la respuesta de una ronda)
+//  ARBOL:        windowQuery sobre el R*-tree (o el índice híbrido) de la tabla
+//  ESCANEO:      test de caja SIMD sobre la proyección plana de la tabla
+//  FUERZA_BRUTA: distancia exacta a todo el almacén, una vez para la consulta
+enum class PlanVentana { ARBOL, ESCANEO, FUERZA_BRUTA };
+
+inline const char* nombrePlan(PlanVentana p) {
+    switch(p) {
+        case PlanVentana::ESCANEO: return "escaneo";
+        case PlanVentana::FUERZA_BRUTA: return "fuerza bruta";
+        default: return "árbol";
+    }
+}
+
+// Costos unitarios del modelo en ns, ajustados con ventanas de 12 a 68
+// dimensiones y 6k a 100k puntos en un Xeon con AVX2. Con árboles y
+// proyecciones más grandes que la caché todo es ancho de banda, así que solo
+// importan las proporciones entre ellos
+struct CostesPlan {
+    double coordenada_nodo = 1.2;        // Una coordenada de una entrada de nodo del R*-tree
+    double coordenada_bloque = 8.0;      // Una coordenada de un grupo de 8 filas (escaneo, filtro híbrido)
+    double grupo = 0.5;                  // Saltar un grupo sin filas vivas en el escaneo
+    double punto = 8.0;                  // Punto emitido por una ventana
+    double coordenada_distancia = 0.1;   // Una coordenada de distancia exacta...
+    double byte_distancia = 0.04;        // ...más esto por byte de la coordenada en el almacén
+    double coordenada_plan = 10.0;       // Estimar una coordenada de una ventana (el propio plan)
+};
+
+// Histograma equi-profundidad de cada coordenada proyectada: CUBETAS + 1
+// cuantiles de una muestra de la tabla. La fracción de puntos con lo ≤ x ≤ hi
+// se interpola linealmente dentro de la cubeta
+template <size_t Dim>
+class HistogramaProyecciones {
+public:
+    static constexpr size_t CUBETAS = 64;
+    static constexpr size_t MUESTRA = 4096;   // Puntos muestreados a paso fijo
+
+private:
+    vector<array<double, CUBETAS + 1>> bordes_;   // Por coordenada
+
+    double acumulada(size_t d, double x) const {
+        const array<double, CUBETAS + 1>& b = bordes_[d];
+        if(x <= b[0]) return 0.0;
+        if(x >= b[CUBETAS]) return 1.0;
+        size_t i = static_cast<size_t>(upper_bound(b.begin(), b.end(), x) - b.begin()) - 1;
+        double ancho = b[i + 1] - b[i];
+        double dentro = ancho > 0.0 ? (x - b[i]) / ancho : 0.0;
+        return (i + dentro) / CUBETAS;
+    }
+
+public:
+    // muestra: proyecciones de los puntos muestreados (se reordena)
+    void construir(vector<array<double, Dim>>& muestra) {
+        bordes_.assign(Dim, {});
+        if(muestra.empty()) return;
+        vector<double> columna(muestra.size());
+        for(size_t d = 0; d < Dim; d++) {
+            for(size_t j = 0; j < muestra.size(); j++) columna[j] = muestra[j][d];
+            sort(columna.begin(), columna.end());
+            for(size_t c = 0; c <= CUBETAS; c++) bordes_[d][c] = columna[c * (columna.size() - 1) / CUBETAS];
+        }
+    }
+
+    bool vacio() const { return bordes_.empty(); }
+
+    double fraccion(size_t d, double lo, double hi) const { return acumulada(d, hi) - acumulada(d, lo); }
+
+    size_t bytes() const { return bordes_.capacity() * sizeof(array<double, CUBETAS + 1>); }
+};
+
+// Proyecciones de una tabla en orden de id, por tramos de TRAMO filas: dentro
+// de un tramo cada coordenada ocupa 4 KB contiguos (SoA por tramo). El escaneo
+// de una ventana recorre las coordenadas de un tramo en secuencia con una
+// máscara de filas vivas por grupo de kernels::FILAS_BLOQUE (el test de caja
+// del índice híbrido, una coordenada a la vez): los grupos sin filas vivas se
+// saltan y el tramo termina en cuanto no queda ninguna. Cada coordenada que
+// se lee es una franja secuencial, no una línea suelta cada Dim × 64 bytes
+template <size_t Dim>
+class ProyeccionPlana {
+public:
+    static constexpr size_t B = kernels::FILAS_BLOQUE;
+    static constexpr size_t GRUPOS = 64;
+    static constexpr size_t TRAMO = GRUPOS * B;   // 512 filas
+
+private:
+    vector<double> tramos_;   // ⌈n/TRAMO⌉ tramos de Dim × TRAMO (coordenada, fila)
+    size_t n_ = 0;
+
+    const double* base(size_t id) const { return &tramos_[(id / TRAMO) * Dim * TRAMO + id % TRAMO]; }
+
+public:
+    // Bytes de los tramos para n puntos
+    static size_t bytesEstimados(size_t n) { return (n + TRAMO - 1) / TRAMO * Dim * TRAMO * sizeof(double); }
+
+    void reservar(size_t n) {
+        n_ = n;
+        tramos_.assign((n + TRAMO - 1) / TRAMO * Dim * TRAMO, 0.0);
+    }
+
+    void asignar(size_t id, const array<double, Dim>& coords) {
+        double* destino = &tramos_[(id / TRAMO) * Dim * TRAMO + id % TRAMO];
+        for(size_t d = 0; d < Dim; d++) destino[d * TRAMO] = coords[d];
+    }
+
+    size_t size() const { return n_; }
+
+    // ||p_id - a||² en el espacio proyectado
+    double distancia2(size_t id, const array<double, Dim>& a) const {
+        const double* p = base(id);
+        double s = 0.0;
+        for(size_t d = 0; d < Dim; d++) {
+            double diff = p[d * TRAMO] - a[d];
+            s += diff * diff;
+        }
+        return s;
+    }
+
+    // visitar(id) de los puntos dentro de la caja, en orden de id; retorna
+    // false para cortar. Retorna true si se recorrió completa
+    template <typename F>
+    bool escanearHasta(const array<double, Dim>& mins, const array<double, Dim>& maxs, F visitar) const {
+        array<uint32_t, GRUPOS> vivos;
+        for(size_t inicio = 0; inicio < n_; inicio += TRAMO) {
+            const double* tramo = &tramos_[inicio / TRAMO * Dim * TRAMO];
+            const size_t filas = min(TRAMO, n_ - inicio);
+            const size_t grupos = (filas + B - 1) / B;
+            for(size_t g = 0; g < grupos; g++) {
+                vivos[g] = (uint32_t(1) << min(B, filas - g * B)) - 1;
+            }
+            for(size_t d = 0; d < Dim; d++) {
+                const double* columna = tramo + d * TRAMO;
+                uint32_t alguno = 0;
+                for(size_t g = 0; g < grupos; g++) {
+                    if(!vivos[g]) continue;
+                    vivos[g] = kernels::cajaBloque(columna + g * B, 0, 1, &mins[d], &maxs[d], vivos[g]);
+                    alguno |= vivos[g];
+                }
+                if(!alguno) break;
+            }
+            for(size_t g = 0; g < grupos; g++) {
+                for(uint32_t v = vivos[g]; v; v &= v - 1) {
+                    if(!visitar(static_cast<int>(inicio + g * B + static_cast<size_t>(__builtin_ctz(v))))) return false;
+                }
+            }
+        }
+        return true;
+    }
+
+    void clear() {
+        vector<double>().swap(tramos_);
+        n_ = 0;
+    }
+
+    size_t bytes() const { return tramos_.capacity() * sizeof(double); }
+};
+
+// Estimación de una ventana [mins, maxs] sobre una tabla de n puntos
+struct EstimacionVentana {
+    double puntos = 0.0;          // Puntos esperados dentro de la ventana
+    double hojas = 0.0;           // Hojas del árbol que toca
+    double coste_arbol = 0.0;     // ns estimados de la windowQuery
+    double coste_escaneo = 0.0;   // ns estimados del escaneo plano
+
+    PlanVentana plan() const { return coste_escaneo < coste_arbol ? PlanVentana::ESCANEO : PlanVentana::ARBOL; }
+    double coste() const { return min(coste_arbol, coste_escaneo); }
+};
+
+// Selectividad: producto de las fracciones por coordenada (independencia,
+// razonable para proyecciones aleatorias). Escaneo: la coordenada d de un
+// grupo se lee si alguna de sus 8 filas pasó las d anteriores, y la de un
+// tramo se recorre (64 grupos) si alguna de sus 512 filas sigue viva.
+// Árbol: el bulk loading parte el espacio por mitades en log2(hojas) niveles
+// sobre las dims_arbol primeras coordenadas y la ventana cruza el corte de un
+// nivel con probabilidad ~p (su ancho en cuantiles); la i-ésima pasada por
+// las mismas coordenadas trabaja sobre rangos 2^i veces más chicos. Cada hoja
+// tocada cuesta n/hojas entradas de dims_arbol coordenadas. En el índice
+// híbrido los aciertos del prefijo caen agrupados (orden de hojas) en
+// bloques de 8 que pagan el test de las coordenadas restantes
+template <size_t Dim>
+EstimacionVentana estimarVentana(const HistogramaProyecciones<Dim>& hist, size_t n, size_t hojas, size_t dims_arbol,
+                                 const array<double, Dim>& mins, const array<double, Dim>& maxs,
+                                 const CostesPlan& costes) {
+    static_assert(ProyeccionPlana<Dim>::B == 8 && ProyeccionPlana<Dim>::TRAMO == 512, "Grupos de 2^3 y tramos de 2^9 filas");
+    constexpr double B = ProyeccionPlana<Dim>::B;
+    constexpr double TRAMO = ProyeccionPlana<Dim>::TRAMO;
+    EstimacionVentana e;
+    double seleccion = 1.0, seleccion_arbol = 1.0, log_medio = 0.0;
+    double coordenadas_grupo = 0.0, coordenadas_tramo = 0.0, coordenadas_resto = 0.0;
+    // 1 - (1 - s)^(2^m): probabilidad de que alguna de 2^m filas siga viva
+    auto alguna = [](double s, int m) {
+        double x = 1.0 - s;
+        for(int i = 0; i < m; i++) x *= x;
+        return 1.0 - x;
+    };
+    for(size_t d = 0; d < Dim; d++) {
+        coordenadas_grupo += alguna(seleccion, 3);
+        coordenadas_tramo += alguna(seleccion, 9);
+        if(d >= dims_arbol && seleccion_arbol > 0.0) coordenadas_resto += alguna(seleccion / seleccion_arbol, 3);
+        double p = hist.fraccion(d, mins[d], maxs[d]);
+        seleccion *= p;
+        if(d < dims_arbol) {
+            seleccion_arbol = seleccion;
+            log_medio += log(max(p, 1e-12));
+        }
+    }
+    e.puntos = n * seleccion;
+    e.coste_escaneo = ceil(n / B) * coordenadas_grupo * costes.coordenada_bloque
+                    + ceil(n / TRAMO) * coordenadas_tramo * ProyeccionPlana<Dim>::GRUPOS * costes.grupo
+                    + e.puntos * costes.punto;
+
+    hojas = max<size_t>(hojas, 1);
+    const double p_medio = exp(log_medio / dims_arbol);
+    const size_t niveles = static_cast<size_t>(ceil(log2(static_cast<double>(hojas))));
+    double fraccion_hojas = 1.0;
+    for(size_t l = 0; l < niveles; l++) {
+        fraccion_hojas *= (1.0 + min(1.0, p_medio * static_cast<double>(size_t(1) << min<size_t>(l / dims_arbol, 30)))) / 2.0;
+    }
+    e.hojas = max(1.0, hojas * fraccion_hojas);
+    e.coste_arbol = e.hojas * (static_cast<double>(n) / hojas) * dims_arbol * costes.coordenada_nodo
+                  + e.puntos * costes.punto;
+    if(dims_arbol < Dim) e.coste_arbol += n * seleccion_arbol / B * coordenadas_resto * costes.coordenada_bloque;
+    return e;
+}
+
+#endif // PLANIFICADOR_H
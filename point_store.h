@@ -0,0 +1,430 @@
+#ifndef POINT_STORE_H
+#define POINT_STORE_H
+
+#include <vector>
+#include <string>
+#include <cstdint>
+#include <cstring>
+#include <cmath>
+#include <stdexcept>
+#include <fstream>
+#include <memory>
+#include "kernels.h"
+#include "disk_store.h"
+
+using namespace std;
+
+// Formato en el que se guardan los puntos originales
+//  F64: double (8 bytes por coordenada, cualquier valor)
+//  F32: float  (4 bytes, redondeo a precisión simple)
+//  U8:  uint8  (1 byte, enteros 0..255, p.ej. píxeles de Fashion-MNIST)
+//  I8:  int8   (1 byte, enteros -128..127)
+enum class FormatoPuntos { F64, F32, U8, I8 };
+
+inline const char* nombreFormato(FormatoPuntos f) {
+    switch(f) {
+        case FormatoPuntos::F32: return "float";
+        case FormatoPuntos::U8: return "uint8";
+        case FormatoPuntos::I8: return "int8";
+        default: return "double";
+    }
+}
+
+// Bytes por coordenada de cada formato
+inline size_t bytesPorCoordenada(FormatoPuntos f) {
+    switch(f) {
+        case FormatoPuntos::F32: return sizeof(float);
+        case FormatoPuntos::U8: return sizeof(uint8_t);
+        case FormatoPuntos::I8: return sizeof(int8_t);
+        default: return sizeof(double);
+    }
+}
+
+// Fila cruda (D coordenadas en `formato`) → D doubles
+inline void filaADouble(FormatoPuntos formato, const char* fila, size_t D, double* salida) {
+    switch(formato) {
+        case FormatoPuntos::F32: {
+            const float* p = reinterpret_cast<const float*>(fila);
+            for(size_t d = 0; d < D; d++) salida[d] = p[d];
+            break;
+        }
+        case FormatoPuntos::U8: {
+            const uint8_t* p = reinterpret_cast<const uint8_t*>(fila);
+            for(size_t d = 0; d < D; d++) salida[d] = p[d];
+            break;
+        }
+        case FormatoPuntos::I8: {
+            const int8_t* p = reinterpret_cast<const int8_t*>(fila);
+            for(size_t d = 0; d < D; d++) salida[d] = p[d];
+            break;
+        }
+        default:
+            memcpy(salida, fila, D * sizeof(double));
+    }
+}
+
+// Escribir n puntos en el formato binario de disk_store.h; fila(j) apunta a
+// las D coordenadas del punto j. En U8/I8 los valores deben ser enteros
+// representables (si no, excepción)
+template <typename Fila>
+void escribirArchivoPuntos(const string& ruta, size_t n, size_t D, FormatoPuntos formato, Fila fila) {
+    ofstream f(ruta, ios::binary);
+    if(!f) throw runtime_error("No se pudo escribir " + ruta);
+    EncabezadoPuntos enc;
+    memcpy(enc.magia, MAGIA_PUNTOS, sizeof(enc.magia));
+    enc.n = n;
+    enc.D = static_cast<uint32_t>(D);
+    enc.formato = static_cast<uint32_t>(formato);
+    enc.reservado = 0;
+    f.write(reinterpret_cast<const char*>(&enc), sizeof(enc));
+
+    const double lo = formato == FormatoPuntos::U8 ? 0.0 : -128.0;
+    const double hi = formato == FormatoPuntos::U8 ? 255.0 : 127.0;
+    vector<char> buffer(D * bytesPorCoordenada(formato));
+    for(size_t j = 0; j < n; j++) {
+        const double* p = fila(j);
+        for(size_t d = 0; d < D; d++) {
+            double v = p[d];
+            switch(formato) {
+                case FormatoPuntos::F64: reinterpret_cast<double*>(buffer.data())[d] = v; break;
+                case FormatoPuntos::F32: reinterpret_cast<float*>(buffer.data())[d] = static_cast<float>(v); break;
+                default:
+                    if(!(v >= lo && v <= hi && std::floor(v) == v)) {
+                        throw runtime_error(string("Valor ") + to_string(v) + " no representable en " + nombreFormato(formato));
+                    }
+                    if(formato == FormatoPuntos::U8) reinterpret_cast<uint8_t*>(buffer.data())[d] = static_cast<uint8_t>(v);
+                    else reinterpret_cast<int8_t*>(buffer.data())[d] = static_cast<int8_t>(v);
+            }
+        }
+        f.write(buffer.data(), buffer.size());
+    }
+    if(!f) throw runtime_error("Error al escribir " + ruta);
+}
+
+// Vista no propietaria de n filas de D doubles separadas por `paso` doubles
+// (paso = D: matriz contigua). Quien es dueño del buffer (vector, mmap, ...)
+// debe mantenerlo vivo mientras se use la vista
+struct VistaMatriz {
+    const double* datos = nullptr;
+    size_t n = 0;
+    size_t D = 0;
+    size_t paso = 0;
+
+    VistaMatriz() = default;
+    VistaMatriz(const double* datos_, size_t n_, size_t D_, size_t paso_ = 0)
+        : datos(datos_), n(n_), D(D_), paso(paso_ ? paso_ : D_) {}
+
+    const double* fila(size_t j) const { return datos + j * paso; }
+    size_t size() const { return n; }
+
+    // Primeras m filas (sin copiar)
+    VistaMatriz prefijo(size_t m) const { return VistaMatriz(datos, m < n ? m : n, D, paso); }
+};
+
+// Almacén de puntos originales D-dimensionales en un único buffer contiguo
+// (fila id = punto con ese id). En U8/I8 las distancias entre puntos enteros
+// se calculan de forma exacta con aritmética entera SIMD. En F64 el almacén
+// puede además adoptar un buffer por move o referenciar una VistaMatriz
+// externa sin copiarla. Fuera de memoria (abrirArchivo) las filas quedan en
+// un archivo binario y se leen bajo demanda con caché LRU.
+class PointStore {
+public:
+    // Query lista para comparar contra el almacén: si es entera y cabe en el
+    // formato compacto se guarda también cuantizada (camino exacto entero)
+    struct Consulta {
+        const double* q = nullptr;
+        bool entera = false;
+        vector<uint8_t> u8;
+        vector<int8_t> i8;
+    };
+
+private:
+    size_t n_;
+    size_t D_;
+    FormatoPuntos formato_;
+    vector<double> f64_;
+    const double* f64_vista_ = nullptr;   // F64 no propietario (referenciar)
+    size_t paso_ = 0;                      // Doubles entre filas de f64_vista_
+    vector<float> f32_;
+    vector<uint8_t> u8_;
+    vector<int8_t> i8_;
+    shared_ptr<ArchivoFilas> disco_;       // Filas en disco (abrirArchivo)
+
+    static bool esEnteroEnRango(double v, double lo, double hi) {
+        return v >= lo && v <= hi && std::floor(v) == v;
+    }
+
+    double minFormato() const { return formato_ == FormatoPuntos::U8 ? 0.0 : -128.0; }
+    double maxFormato() const { return formato_ == FormatoPuntos::U8 ? 255.0 : 127.0; }
+
+    const double* filaF64(size_t id) const {
+        return f64_vista_ ? f64_vista_ + id * paso_ : f64_.data() + id * D_;
+    }
+
+    // Fila id en memoria, cruda en el formato del almacén
+    const char* puntero(size_t id) const {
+        switch(formato_) {
+            case FormatoPuntos::F32: return reinterpret_cast<const char*>(&f32_[id * D_]);
+            case FormatoPuntos::U8: return reinterpret_cast<const char*>(&u8_[id * D_]);
+            case FormatoPuntos::I8: return reinterpret_cast<const char*>(&i8_[id * D_]);
+            default: return reinterpret_cast<const char*>(filaF64(id));
+        }
+    }
+
+public:
+    PointStore() : n_(0), D_(0), formato_(FormatoPuntos::F64) {}
+
+    // Copiar filas al buffer contiguo en el formato pedido; con `orden` la fila
+    // id del almacén es filas[(*orden)[id]].
+    // En U8/I8 todos los valores deben ser enteros representables (si no, excepción)
+    void asignar(const vector<vector<double>>& filas, size_t D, FormatoPuntos formato,
+                 const vector<int>* orden = nullptr) {
+        for(size_t j = 0; j < filas.size(); j++) {
+            if(filas[j].size() != D) {
+                throw runtime_error("Punto " + to_string(j) + " debe tener " + to_string(D) + " dimensiones");
+            }
+        }
+        asignarFilas(filas.size(), D, formato, [&](size_t j) { return filas[j].data(); }, orden);
+    }
+
+    // Igual que asignar() desde cualquier origen de filas: fila(j) retorna un
+    // puntero a las D coordenadas de la fila j
+    template <typename Fila>
+    void asignarFilas(size_t n, size_t D, FormatoPuntos formato, Fila fila, const vector<int>* orden = nullptr) {
+        clear();
+        formato_ = formato;
+        D_ = D;
+        n_ = n;
+
+        if(formato_ == FormatoPuntos::F64) f64_.resize(n_ * D_);
+        else if(formato_ == FormatoPuntos::F32) f32_.resize(n_ * D_);
+        else if(formato_ == FormatoPuntos::U8) u8_.resize(n_ * D_);
+        else i8_.resize(n_ * D_);
+
+        for(size_t id = 0; id < n_; id++) {
+            size_t origen = orden ? static_cast<size_t>((*orden)[id]) : id;
+            const double* p = fila(origen);
+            for(size_t d = 0; d < D_; d++) {
+                double v = p[d];
+                if(formato_ == FormatoPuntos::F64) {
+                    f64_[id * D_ + d] = v;
+                    continue;
+                }
+                if(formato_ == FormatoPuntos::F32) {
+                    f32_[id * D_ + d] = static_cast<float>(v);
+                    continue;
+                }
+                if(!esEnteroEnRango(v, minFormato(), maxFormato())) {
+                    throw runtime_error(string("Valor ") + to_string(v) + " no representable en " + nombreFormato(formato_));
+                }
+                if(formato_ == FormatoPuntos::U8) u8_[id * D_ + d] = static_cast<uint8_t>(v);
+                else i8_[id * D_ + d] = static_cast<int8_t>(v);
+            }
+        }
+    }
+
+    // F64 sin copia: adoptar un buffer n×D contiguo. Con `orden` las filas se
+    // permutan en el mismo buffer (ciclos de la permutación, una fila auxiliar)
+    void adoptar(vector<double>&& plano, size_t D, const vector<int>* orden = nullptr) {
+        if(D == 0 || plano.size() % D != 0) throw runtime_error("Buffer de tamaño no múltiplo de D = " + to_string(D));
+        clear();
+        formato_ = FormatoPuntos::F64;
+        D_ = D;
+        n_ = plano.size() / D;
+        f64_ = move(plano);
+        if(!orden) return;
+
+        vector<bool> colocada(n_, false);
+        vector<double> aux(D_);
+        for(size_t inicio = 0; inicio < n_; inicio++) {
+            if(colocada[inicio]) continue;
+            // Ciclo: la fila id recibe la fila (*orden)[id]
+            copy(&f64_[inicio * D_], &f64_[inicio * D_] + D_, aux.begin());
+            size_t id = inicio;
+            while(true) {
+                colocada[id] = true;
+                size_t origen = static_cast<size_t>((*orden)[id]);
+                if(origen == inicio) {
+                    copy(aux.begin(), aux.end(), &f64_[id * D_]);
+                    break;
+                }
+                copy(&f64_[origen * D_], &f64_[origen * D_] + D_, &f64_[id * D_]);
+                id = origen;
+            }
+        }
+    }
+
+    // F64 sin copia ni propiedad: las distancias se calculan sobre la vista
+    // (su buffer debe sobrevivir al almacén)
+    void referenciar(const VistaMatriz& vista) {
+        clear();
+        formato_ = FormatoPuntos::F64;
+        D_ = vista.D;
+        n_ = vista.n;
+        f64_vista_ = vista.datos;
+        paso_ = vista.paso;
+    }
+
+    // true si las filas viven en un buffer externo (referenciar)
+    bool esVista() const { return f64_vista_ != nullptr; }
+
+    // Fuera de memoria: las filas se quedan en el archivo binario `ruta` (ver
+    // disk_store.h) y en memoria solo vive la caché LRU de filas_cache filas.
+    // filas > 0 usa solo las primeras `filas` del archivo
+    void abrirArchivo(const string& ruta, size_t filas_cache, size_t hilos_io, size_t filas = 0) {
+        clear();
+        disco_ = make_shared<ArchivoFilas>(ruta, filas_cache, hilos_io);
+        const EncabezadoPuntos& enc = disco_->encabezado();
+        formato_ = static_cast<FormatoPuntos>(enc.formato);
+        D_ = enc.D;
+        n_ = filas > 0 ? min<size_t>(filas, enc.n) : enc.n;
+    }
+
+    bool enDisco() const { return disco_ != nullptr; }
+    size_t bytesFila() const { return D_ * bytesPorCoordenada(formato_); }
+
+    // Filas crudas de ids[0..m) en `destino` (m × bytesFila()): en disco un
+    // lote de preads agrupados; en memoria una copia
+    void leerFilas(const int* ids, size_t m, vector<char>& destino) const {
+        destino.resize(m * bytesFila());
+        if(disco_) {
+            disco_->leer(ids, m, destino.data());
+            return;
+        }
+        for(size_t j = 0; j < m; j++) memcpy(&destino[j * bytesFila()], puntero(ids[j]), bytesFila());
+    }
+
+    // visitar(id, fila cruda) para todas las filas en orden. En disco se lee
+    // por bloques secuenciales de ~1 MB sin pasar por la caché
+    template <typename F>
+    void recorrer(F visitar) const {
+        if(!disco_) {
+            for(size_t id = 0; id < n_; id++) visitar(id, puntero(id));
+            return;
+        }
+        const size_t por_bloque = max<size_t>(1, (size_t(1) << 20) / bytesFila());
+        vector<char> bloque;
+        for(size_t inicio = 0; inicio < n_; inicio += por_bloque) {
+            size_t filas = min(por_bloque, n_ - inicio);
+            bloque.resize(filas * bytesFila());
+            disco_->leerSecuencial(inicio, filas, bloque.data());
+            for(size_t j = 0; j < filas; j++) visitar(inicio + j, &bloque[j * bytesFila()]);
+        }
+    }
+
+    ArchivoFilas::Contadores contadoresDisco() const {
+        return disco_ ? disco_->contadores() : ArchivoFilas::Contadores();
+    }
+
+    Consulta preparar(const vector<double>& query) const {
+        Consulta c;
+        c.q = query.data();
+        if(formato_ == FormatoPuntos::F64 || formato_ == FormatoPuntos::F32) return c;
+
+        c.entera = true;
+        for(double v : query) {
+            if(!esEnteroEnRango(v, minFormato(), maxFormato())) { c.entera = false; break; }
+        }
+        if(c.entera) {
+            if(formato_ == FormatoPuntos::U8) c.u8.assign(query.begin(), query.end());
+            else c.i8.assign(query.begin(), query.end());
+        }
+        return c;
+    }
+
+    // ||q - p||² con p una fila cruda en el formato del almacén
+    template <size_t DC = 0>
+    double distancia2Fila(const Consulta& c, const char* fila) const {
+        const size_t D = DC ? DC : D_;
+        switch(formato_) {
+            case FormatoPuntos::F32:
+                return kernels::l2sq_f64_f32<DC>(c.q, reinterpret_cast<const float*>(fila), D);
+            case FormatoPuntos::U8: {
+                const uint8_t* p = reinterpret_cast<const uint8_t*>(fila);
+                if(c.entera) return static_cast<double>(kernels::l2sq_u8<DC>(c.u8.data(), p, D));
+                return kernels::l2sq_f64_u8<DC>(c.q, p, D);
+            }
+            case FormatoPuntos::I8: {
+                const int8_t* p = reinterpret_cast<const int8_t*>(fila);
+                if(c.entera) return static_cast<double>(kernels::l2sq_i8<DC>(c.i8.data(), p, D));
+                return kernels::l2sq_f64_i8<DC>(c.q, p, D);
+            }
+            default:
+                return kernels::l2sq_f64<DC>(c.q, reinterpret_cast<const double*>(fila), D);
+        }
+    }
+
+    // ||q - p_id||². DC > 0 fija la dimensión en compilación (debe ser dim()).
+    // En disco lee la fila (caché LRU); la verificación usa leerFilas por lotes
+    template <size_t DC = 0>
+    double distancia2(const Consulta& c, size_t id) const {
+        if(disco_) {
+            vector<char> fila;
+            int id_fila = static_cast<int>(id);
+            leerFilas(&id_fila, 1, fila);
+            return distancia2Fila<DC>(c, fila.data());
+        }
+        return distancia2Fila<DC>(c, puntero(id));
+    }
+
+    // Pedir a caché todas las líneas de la fila id (no bloquea)
+    void prefetch(size_t id) const {
+        if(disco_) return;
+        const char* p = puntero(id);
+        size_t bytes = D_ * bytesPorCoordenada(formato_);
+        for(size_t off = 0; off < bytes; off += 64) __builtin_prefetch(p + off, 0, 3);
+    }
+
+    template <size_t DC = 0>
+    double distancia(const Consulta& c, size_t id) const {
+        return std::sqrt(distancia2<DC>(c, id));
+    }
+
+    // Copia del punto id en double
+    vector<double> fila(size_t id) const {
+        vector<double> p(D_);
+        if(disco_) {
+            vector<char> cruda;
+            int id_fila = static_cast<int>(id);
+            leerFilas(&id_fila, 1, cruda);
+            filaADouble(formato_, cruda.data(), D_, p.data());
+            return p;
+        }
+        for(size_t d = 0; d < D_; d++) p[d] = valor(id, d);
+        return p;
+    }
+
+    double valor(size_t id, size_t d) const {
+        if(disco_) return fila(id)[d];
+        switch(formato_) {
+            case FormatoPuntos::F32: return f32_[id * D_ + d];
+            case FormatoPuntos::U8: return u8_[id * D_ + d];
+            case FormatoPuntos::I8: return i8_[id * D_ + d];
+            default: return filaF64(id)[d];
+        }
+    }
+
+    size_t size() const { return n_; }
+    size_t dim() const { return D_; }
+    FormatoPuntos formato() const { return formato_; }
+
+    // Bytes reservados para las coordenadas (0 para una vista externa; en
+    // disco, la caché de filas)
+    size_t bytes() const {
+        return f64_.capacity() * sizeof(double) + f32_.capacity() * sizeof(float)
+             + u8_.capacity() + i8_.capacity() + (disco_ ? disco_->bytesCache() : 0);
+    }
+
+    void clear() {
+        vector<double>().swap(f64_);
+        vector<float>().swap(f32_);
+        vector<uint8_t>().swap(u8_);
+        vector<int8_t>().swap(i8_);
+        f64_vista_ = nullptr;
+        paso_ = 0;
+        disco_.reset();
+        n_ = 0;
+    }
+};
+
+#endif // POINT_STORE_H
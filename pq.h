@@ -0,0 +1,143 @@
+#ifndef PQ_H
+#define PQ_H
+
+#include <vector>
+#include <cstdint>
+#include <random>
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+#include "point_store.h"
+#include "kmeans.h"
+
+using namespace std;
+
+// Product Quantization del almacén de puntos.
+// El espacio D-dim se divide en M subespacios contiguos; cada subvector se
+// codifica con el índice (1 byte) de su centroide más cercano entre 256.
+// Con una query se precalcula una tabla M×256 de distancias parciales
+// (distancia asimétrica, ADC) y ||q - p||² ≈ Σ_m tabla[m][codigo_m(p)].
+class ProductQuantizer {
+public:
+    static constexpr size_t KSUB = 256;  // Centroides por subespacio
+
+private:
+    size_t D_;
+    size_t M_;
+    vector<size_t> inicio_;      // Primera dimensión de cada subespacio (M+1 entradas)
+    vector<float> centroides_;   // Por subespacio m: KSUB × dsub(m), desde offset_[m]
+    vector<size_t> offset_;
+    vector<uint8_t> codigos_;    // n × M
+
+    size_t dsub(size_t m) const { return inicio_[m + 1] - inicio_[m]; }
+
+public:
+    ProductQuantizer() : D_(0), M_(0) {}
+
+    // Entrenar centroides con una muestra del almacén y codificar todos los puntos
+    void construir(const PointStore& datos, size_t M, size_t muestra = 4096,
+                   int iteraciones = 6, unsigned seed = 42) {
+        D_ = datos.dim();
+        if(M == 0 || M > D_) throw runtime_error("PQ: M debe estar en [1, D]");
+        M_ = M;
+
+        inicio_.resize(M_ + 1);
+        offset_.resize(M_ + 1);
+        for(size_t m = 0; m <= M_; m++) inicio_[m] = m * D_ / M_;
+        offset_[0] = 0;
+        for(size_t m = 0; m < M_; m++) offset_[m + 1] = offset_[m] + KSUB * dsub(m);
+        centroides_.assign(offset_[M_], 0.0f);
+
+        // Muestra de entrenamiento
+        mt19937 gen(seed);
+        size_t n = datos.size();
+        vector<size_t> ids(n);
+        for(size_t i = 0; i < n; i++) ids[i] = i;
+        shuffle(ids.begin(), ids.end(), gen);
+        ids.resize(min(muestra, n));
+
+        for(size_t m = 0; m < M_; m++) {
+            size_t ds = dsub(m);
+            vector<float> sub(ids.size() * ds);
+            for(size_t i = 0; i < ids.size(); i++) {
+                for(size_t d = 0; d < ds; d++) {
+                    sub[i * ds + d] = static_cast<float>(datos.valor(ids[i], inicio_[m] + d));
+                }
+            }
+            vector<float> c = kmeansLloyd(sub, ids.size(), ds, KSUB, iteraciones, gen);
+            copy(c.begin(), c.end(), centroides_.begin() + offset_[m]);
+        }
+
+        // Codificar todo el almacén
+        codigos_.assign(n * M_, 0);
+        vector<float> sub;
+        for(size_t id = 0; id < n; id++) {
+            vector<double> punto = datos.fila(id);   // Una lectura por punto (almacén en disco)
+            for(size_t m = 0; m < M_; m++) {
+                size_t ds = dsub(m);
+                sub.resize(ds);
+                for(size_t d = 0; d < ds; d++) sub[d] = static_cast<float>(punto[inicio_[m] + d]);
+                codigos_[id * M_ + m] = static_cast<uint8_t>(centroideMasCercano(m, sub.data()));
+            }
+        }
+    }
+
+    size_t centroideMasCercano(size_t m, const float* sub) const {
+        size_t ds = dsub(m);
+        const float* c = &centroides_[offset_[m]];
+        float mejor = numeric_limits<float>::max();
+        size_t mejor_c = 0;
+        for(size_t j = 0; j < KSUB; j++) {
+            float d2 = 0.0f;
+            for(size_t d = 0; d < ds; d++) {
+                float diff = sub[d] - c[j * ds + d];
+                d2 += diff * diff;
+            }
+            if(d2 < mejor) { mejor = d2; mejor_c = j; }
+        }
+        return mejor_c;
+    }
+
+    // Tabla ADC de la query: tabla[m * KSUB + j] = ||q_m - centroide_mj||²
+    vector<float> tablaDistancias(const double* q) const {
+        vector<float> tabla(M_ * KSUB);
+        for(size_t m = 0; m < M_; m++) {
+            size_t ds = dsub(m);
+            const float* c = &centroides_[offset_[m]];
+            const double* qm = q + inicio_[m];
+            for(size_t j = 0; j < KSUB; j++) {
+                float d2 = 0.0f;
+                for(size_t d = 0; d < ds; d++) {
+                    float diff = static_cast<float>(qm[d]) - c[j * ds + d];
+                    d2 += diff * diff;
+                }
+                tabla[m * KSUB + j] = d2;
+            }
+        }
+        return tabla;
+    }
+
+    // Distancia al cuadrado aproximada entre la query (tabla) y el punto id
+    float distanciaAsimetrica(const vector<float>& tabla, size_t id) const {
+        const uint8_t* codigo = &codigos_[id * M_];
+        float sum = 0.0f;
+        for(size_t m = 0; m < M_; m++) sum += tabla[m * KSUB + codigo[m]];
+        return sum;
+    }
+
+    bool activo() const { return M_ > 0; }
+    size_t subespacios() const { return M_; }
+
+    // Bytes de códigos + centroides
+    size_t bytes() const {
+        return codigos_.size() + centroides_.size() * sizeof(float);
+    }
+
+    void clear() {
+        vector<uint8_t>().swap(codigos_);
+        vector<float>().swap(centroides_);
+        M_ = 0;
+    }
+};
+
+#endif // PQ_H
@@ -0,0 +1,78 @@
+#ifndef SHARD_H
+#define SHARD_H
+
+#include <vector>
+#include <string>
+#include <iostream>
+#include <unistd.h>
+#include <sys/socket.h>
+#include "DBLSH.h"
+#include "net_protocol.h"
+
+using namespace std;
+
+// Partición round-robin del dataset: el shard s de N recibe los puntos con
+// id global ≡ s (mod N). ids_globales[id local] = id global
+inline void particionarDataset(const vector<vector<double>>& datos, int shard, int num_shards,
+                               vector<vector<double>>& parte, vector<int>& ids_globales) {
+    parte.clear();
+    ids_globales.clear();
+    for(size_t id = shard; id < datos.size(); id += num_shards) {
+        parte.push_back(datos[id]);
+        ids_globales.push_back(static_cast<int>(id));
+    }
+}
+
+// Servir consultas k-NN de un shard por un socket Unix hasta recibir FIN.
+// Todos los shards deben construirse con la misma semilla (mismas funciones hash)
+// para que la unión de sus resultados equivalga a un único índice
+template <size_t K>
+void servirShard(const DBLSH<K>& indice, const vector<int>& ids_globales, const string& ruta_socket) {
+    int fd_escucha = protocolo::escucharUnix(ruta_socket);
+    bool activo = true;
+
+    while(activo) {
+        int fd = ::accept(fd_escucha, nullptr, nullptr);
+        if(fd < 0) continue;
+
+        protocolo::Mensaje m;
+        try {
+            while(protocolo::recibir(fd, m)) {
+                if(m.tipo == protocolo::FIN) {
+                    activo = false;
+                    break;
+                }
+                // Toda petición recibe respuesta (RESPUESTA_KNN o ERROR): el
+                // coordinador espera una por shard
+                string error;
+                if(m.tipo != protocolo::CONSULTA_KNN) {
+                    error = "Tipo de mensaje no soportado por el shard: " + to_string(m.tipo);
+                } else {
+                    try {
+                        vector<double> query;
+                        double c;
+                        int k;
+                        protocolo::decodificarConsulta(m.datos, query, c, k);
+
+                        vector<pair<int, double>> vecinos;
+                        for(const auto& v : indice.C_ANN_K(query, c, k)) {
+                            vecinos.push_back({ids_globales[get<0>(v)], get<2>(v)});
+                        }
+                        protocolo::enviar(fd, protocolo::RESPUESTA_KNN, protocolo::codificarRespuesta(vecinos));
+                    } catch(const runtime_error& e) {
+                        error = e.what();
+                    }
+                }
+                if(!error.empty()) protocolo::enviar(fd, protocolo::ERROR, vector<char>(error.begin(), error.end()));
+            }
+        } catch(const exception& e) {
+            cerr << "Shard " << ruta_socket << ": " << e.what() << endl;
+        }
+        ::close(fd);
+    }
+
+    ::close(fd_escucha);
+    ::unlink(ruta_socket.c_str());
+}
+
+#endif // SHARD_H
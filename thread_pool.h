@@ -0,0 +1,110 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <vector>
+#include <queue>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <atomic>
+#include <algorithm>
+#include <exception>
+
+using namespace std;
+
+// Pool de hilos fijo con cola FIFO de tareas
+class ThreadPool {
+    vector<thread> hilos_;
+    queue<function<void()>> tareas_;
+    mutex mtx_;
+    condition_variable cv_;
+    bool detenido_ = false;
+
+public:
+    explicit ThreadPool(size_t num_hilos = thread::hardware_concurrency()) {
+        num_hilos = max<size_t>(1, num_hilos);
+        for(size_t i = 0; i < num_hilos; i++) {
+            hilos_.emplace_back([this] {
+                while(true) {
+                    function<void()> tarea;
+                    {
+                        unique_lock<mutex> lock(mtx_);
+                        cv_.wait(lock, [this] { return detenido_ || !tareas_.empty(); });
+                        if(detenido_ && tareas_.empty()) return;
+                        tarea = move(tareas_.front());
+                        tareas_.pop();
+                    }
+                    tarea();
+                }
+            });
+        }
+    }
+
+    ~ThreadPool() {
+        {
+            lock_guard<mutex> lock(mtx_);
+            detenido_ = true;
+        }
+        cv_.notify_all();
+        for(auto& h : hilos_) h.join();
+    }
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    template <typename F>
+    future<void> enviar(F&& f) {
+        auto tarea = make_shared<packaged_task<void()>>(forward<F>(f));
+        future<void> resultado = tarea->get_future();
+        {
+            lock_guard<mutex> lock(mtx_);
+            tareas_.push([tarea] { (*tarea)(); });
+        }
+        cv_.notify_one();
+        return resultado;
+    }
+
+    // Ejecutar fn(i) para i en [0, n) repartiendo los índices entre los hilos
+    // (reparto dinámico con un contador atómico). Bloquea hasta terminar.
+    // Si fn lanza, los demás trabajadores dejan de tomar índices y, cuando
+    // todos terminaron (usan `siguiente` y `fn` de esta pila), se relanza la
+    // primera excepción
+    template <typename F>
+    void paraCada(size_t n, F fn) {
+        if(n == 0) return;
+        atomic<size_t> siguiente(0);
+        size_t trabajadores = min(n, hilos_.size());
+        vector<future<void>> pendientes;
+        pendientes.reserve(trabajadores);
+        exception_ptr error;
+        try {
+            for(size_t w = 0; w < trabajadores; w++) {
+                pendientes.push_back(enviar([&] {
+                    try {
+                        for(size_t i = siguiente++; i < n; i = siguiente++) fn(i);
+                    } catch(...) {
+                        siguiente.store(n);
+                        throw;
+                    }
+                }));
+            }
+        } catch(...) {
+            siguiente.store(n);
+            error = current_exception();
+        }
+        for(auto& p : pendientes) {
+            try {
+                p.get();
+            } catch(...) {
+                if(!error) error = current_exception();
+            }
+        }
+        if(error) rethrow_exception(error);
+    }
+
+    size_t size() const { return hilos_.size(); }
+};
+
+#endif // THREAD_POOL_H
@@ -0,0 +1,131 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <vector>
+#include <array>
+#include <string>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <stdexcept>
+#include <cstdint>
+
+using namespace std;
+
+// Trazas por alcance (RAII) exportables al formato trace_event de Chrome
+// (abrir el JSON en https://ui.perfetto.dev o chrome://tracing).
+//
+//   TRACE_SCOPE("bulkLoad");      // registra [inicio, fin) del bloque actual
+//   traza::activar(true);
+//   ...
+//   traza::exportarChrome("results/traza.json");
+//
+// Cada hilo escribe en su propio anillo de CAPACIDAD eventos (sin locks; los
+// más viejos se sobrescriben). Desactivadas cuestan una carga atómica relajada
+// por alcance; compilando con -DDBLSH_SIN_TRAZAS desaparecen por completo.
+namespace traza {
+
+struct Evento {
+    const char* nombre;   // Literal: no se copia
+    uint64_t inicio_ns;
+    uint64_t duracion_ns;
+};
+
+struct Anillo {
+    static constexpr size_t CAPACIDAD = 1 << 16;
+    array<Evento, CAPACIDAD> eventos;
+    atomic<uint64_t> escritos{0};
+    uint32_t tid = 0;
+};
+
+inline atomic<bool> activo{false};
+
+inline uint64_t ahoraNs() {
+    static const auto origen = chrono::steady_clock::now();
+    return chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - origen).count();
+}
+
+// Anillos de todos los hilos (el registro solo se toca al primer evento de cada hilo)
+struct Registro {
+    mutex mtx;
+    vector<shared_ptr<Anillo>> anillos;
+};
+
+inline Registro& registro() {
+    static Registro r;
+    return r;
+}
+
+inline Anillo& anilloLocal() {
+    thread_local shared_ptr<Anillo> anillo = [] {
+        auto nuevo = make_shared<Anillo>();
+        Registro& r = registro();
+        lock_guard<mutex> lock(r.mtx);
+        nuevo->tid = static_cast<uint32_t>(r.anillos.size() + 1);
+        r.anillos.push_back(nuevo);
+        return nuevo;
+    }();
+    return *anillo;
+}
+
+inline void registrar(const char* nombre, uint64_t inicio_ns, uint64_t fin_ns) {
+    Anillo& a = anilloLocal();
+    uint64_t n = a.escritos.load(memory_order_relaxed);
+    a.eventos[n % Anillo::CAPACIDAD] = {nombre, inicio_ns, fin_ns - inicio_ns};
+    a.escritos.store(n + 1, memory_order_release);
+}
+
+inline void activar(bool on) { activo.store(on, memory_order_relaxed); }
+
+class Alcance {
+    const char* nombre_;
+    uint64_t inicio_ns_;
+    bool on_;
+public:
+    explicit Alcance(const char* nombre) : nombre_(nombre), inicio_ns_(0), on_(activo.load(memory_order_relaxed)) {
+        if(on_) inicio_ns_ = ahoraNs();
+    }
+    ~Alcance() {
+        if(on_) registrar(nombre_, inicio_ns_, ahoraNs());
+    }
+    Alcance(const Alcance&) = delete;
+    Alcance& operator=(const Alcance&) = delete;
+};
+
+// Escribir los eventos retenidos como JSON de Chrome (eventos "X", µs).
+// Llamar con los hilos trazados en reposo
+inline void exportarChrome(const string& ruta) {
+    ofstream f(ruta);
+    if(!f) throw runtime_error("No se pudo escribir " + ruta);
+    f << "{\"traceEvents\":[\n";
+    bool primero = true;
+    Registro& r = registro();
+    lock_guard<mutex> lock(r.mtx);
+    for(const auto& a : r.anillos) {
+        uint64_t n = a->escritos.load(memory_order_acquire);
+        uint64_t desde = n > Anillo::CAPACIDAD ? n - Anillo::CAPACIDAD : 0;
+        for(uint64_t i = desde; i < n; i++) {
+            const Evento& e = a->eventos[i % Anillo::CAPACIDAD];
+            if(!primero) f << ",\n";
+            primero = false;
+            f << "{\"name\":\"" << e.nombre << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << a->tid
+              << ",\"ts\":" << e.inicio_ns / 1000.0 << ",\"dur\":" << e.duracion_ns / 1000.0 << "}";
+        }
+    }
+    f << "\n],\"displayTimeUnit\":\"ms\"}\n";
+}
+
+} // namespace traza
+
+#define TRACE_CONCAT_(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_(a, b)
+
+#ifdef DBLSH_SIN_TRAZAS
+#define TRACE_SCOPE(nombre) ((void)0)
+#else
+#define TRACE_SCOPE(nombre) traza::Alcance TRACE_CONCAT(traza_alcance_, __LINE__)(nombre)
+#endif
+
+#endif // TRACE_H
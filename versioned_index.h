@@ -0,0 +1,233 @@
+#ifndef VERSIONED_INDEX_H
+#define VERSIONED_INDEX_H
+
+#include <vector>
+#include <array>
+#include <memory>
+#include <functional>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <tuple>
+#include <algorithm>
+#include <stdexcept>
+#include <cstdint>
+#include "DBLSH.h"
+#include "kernels.h"
+#include "thread_pool.h"
+
+using namespace std;
+
+// Índice DB-LSH versionado para ingesta concurrente con consultas.
+//
+// Cada versión es inmutable: un DBLSH base (bulk-loaded) más una lista de lotes
+// delta aún no indexados. Los escritores agregan lotes (nueva versión con un lote
+// más) y publicar() reconstruye el base con todo el delta fuera del camino de los
+// lectores; después se instala la nueva versión con un intercambio atómico.
+//
+// Los lectores no toman locks: fijan la versión actual anunciando la época global
+// en una ranura propia. Una versión retirada en la época e se libera cuando ningún
+// lector activo anunció una época ≤ e (reclamación por épocas).
+//
+// Los ids son globales y estables: orden de llegada de los puntos.
+template <size_t K>
+class IndiceVersionado {
+public:
+    using Resultado = vector<tuple<int, vector<double>, double>>;
+    using Fabrica = function<unique_ptr<DBLSH<K>>()>;
+
+private:
+    struct Version {
+        shared_ptr<const DBLSH<K>> base;                        // nullptr antes de la primera publicación
+        size_t n_base = 0;                                      // ids [0, n_base) en el base
+        vector<shared_ptr<const vector<vector<double>>>> delta; // Lotes inmutables, ids a partir de n_base
+        size_t n_delta = 0;
+        uint64_t numero = 0;
+    };
+
+    struct alignas(64) Ranura {
+        atomic<uint64_t> epoca{0};  // 0 = libre
+    };
+
+    static constexpr size_t MAX_LECTORES = 128;
+
+    int D_;
+    Fabrica fabrica_;
+    atomic<Version*> actual_;
+    atomic<uint64_t> epoca_{1};
+    mutable array<Ranura, MAX_LECTORES> ranuras_;
+    mutex mtx_escritura_;     // Serializa cambios de versión
+    mutex mtx_publicacion_;   // Una reconstrucción a la vez
+    vector<pair<uint64_t, Version*>> retiradas_;
+
+    // Fija la versión actual mientras vive (sin locks)
+    class Lectura {
+        const IndiceVersionado& indice_;
+        size_t ranura_;
+        const Version* version_;
+    public:
+        explicit Lectura(const IndiceVersionado& indice) : indice_(indice) {
+            size_t i = hash<thread::id>{}(this_thread::get_id()) % MAX_LECTORES;
+            while(true) {
+                uint64_t libre = 0;
+                if(indice_.ranuras_[i].epoca.compare_exchange_strong(libre, indice_.epoca_.load())) break;
+                i = (i + 1) % MAX_LECTORES;
+            }
+            ranura_ = i;
+            version_ = indice_.actual_.load();
+        }
+        ~Lectura() { indice_.ranuras_[ranura_].epoca.store(0, memory_order_release); }
+        Lectura(const Lectura&) = delete;
+        Lectura& operator=(const Lectura&) = delete;
+
+        const Version& operator*() const { return *version_; }
+        const Version* operator->() const { return version_; }
+    };
+
+    // Requiere mtx_escritura_
+    void instalar(Version* nueva) {
+        Version* vieja = actual_.exchange(nueva);
+        uint64_t e = epoca_.fetch_add(1);
+        retiradas_.push_back({e, vieja});
+        recolectar();
+    }
+
+    // Liberar las versiones que ningún lector activo puede estar usando (requiere mtx_escritura_)
+    void recolectar() {
+        uint64_t minima = UINT64_MAX;
+        for(const auto& r : ranuras_) {
+            uint64_t e = r.epoca.load();
+            if(e != 0) minima = min(minima, e);
+        }
+        auto fin = remove_if(retiradas_.begin(), retiradas_.end(), [&](const pair<uint64_t, Version*>& r) {
+            if(r.first >= minima) return false;
+            delete r.second;
+            return true;
+        });
+        retiradas_.erase(fin, retiradas_.end());
+    }
+
+    // Búsqueda exacta en el delta y mezcla con los resultados del base
+    void mezclarDelta(const Version& v, const vector<double>& query, int k, Resultado& res) const {
+        if(v.n_delta == 0) return;
+        int id = static_cast<int>(v.n_base);
+        for(const auto& lote : v.delta) {
+            for(const auto& p : *lote) {
+                double dist = std::sqrt(kernels::l2sq_f64(query.data(), p.data(), D_));
+                res.push_back({id++, p, dist});
+            }
+        }
+        sort(res.begin(), res.end(), [](const auto& a, const auto& b) { return get<2>(a) < get<2>(b); });
+        if((int)res.size() > k) res.resize(k);
+    }
+
+    // C_ANN_K del paper no termina si k > n: limitar al tamaño del base
+    static int kBase(const Version& v, int k) { return min<int>(k, static_cast<int>(v.n_base)); }
+
+public:
+    // fabrica crea un DBLSH vacío ya configurado (almacén, PQ...). Todas las
+    // versiones usan la misma fábrica, así que las funciones hash no cambian
+    IndiceVersionado(int D, Fabrica fabrica) : D_(D), fabrica_(move(fabrica)), actual_(new Version()) {}
+
+    ~IndiceVersionado() {
+        for(auto& r : retiradas_) delete r.second;
+        delete actual_.load();
+    }
+
+    IndiceVersionado(const IndiceVersionado&) = delete;
+    IndiceVersionado& operator=(const IndiceVersionado&) = delete;
+
+    // Agregar un lote al delta (visible de inmediato por búsqueda exacta).
+    // Retorna el id global del primer punto del lote
+    int agregar(vector<vector<double>> lote) {
+        for(const auto& p : lote) {
+            if((int)p.size() != D_) throw runtime_error("Punto debe tener " + to_string(D_) + " dimensiones");
+        }
+        auto compartido = make_shared<const vector<vector<double>>>(move(lote));
+
+        lock_guard<mutex> lock(mtx_escritura_);
+        const Version* v = actual_.load();
+        Version* nueva = new Version(*v);
+        int primer_id = static_cast<int>(v->n_base + v->n_delta);
+        nueva->n_delta += compartido->size();
+        nueva->delta.push_back(move(compartido));
+        nueva->numero++;
+        instalar(nueva);
+        return primer_id;
+    }
+
+    // Reconstruir el base con todo el delta actual y publicarlo. Los lectores
+    // siguen usando la versión anterior durante la construcción; los lotes
+    // agregados mientras tanto pasan al delta de la nueva versión.
+    // Retorna el número de puntos del nuevo base
+    size_t publicar() {
+        lock_guard<mutex> lock_publicacion(mtx_publicacion_);
+
+        shared_ptr<const DBLSH<K>> base;
+        vector<shared_ptr<const vector<vector<double>>>> lotes;
+        {
+            lock_guard<mutex> lock(mtx_escritura_);
+            const Version* v = actual_.load();
+            if(v->n_delta == 0) return v->n_base;
+            base = v->base;
+            lotes = v->delta;
+        }
+
+        vector<vector<double>> filas;
+        size_t n_base = base ? base->getDatasetSize() : 0;
+        for(size_t id = 0; id < n_base; id++) filas.push_back(base->punto(static_cast<int>(id)));
+        for(const auto& lote : lotes) filas.insert(filas.end(), lote->begin(), lote->end());
+
+        unique_ptr<DBLSH<K>> nuevo = fabrica_();
+        nuevo->insertar(filas);
+        size_t n_nuevo = filas.size();
+
+        lock_guard<mutex> lock(mtx_escritura_);
+        const Version* v = actual_.load();
+        Version* nueva = new Version();
+        nueva->base = shared_ptr<const DBLSH<K>>(move(nuevo));
+        nueva->n_base = n_nuevo;
+        nueva->delta.assign(v->delta.begin() + lotes.size(), v->delta.end());
+        nueva->n_delta = v->n_base + v->n_delta - n_nuevo;
+        nueva->numero = v->numero + 1;
+        instalar(nueva);
+        return n_nuevo;
+    }
+
+    Resultado C_ANN_K(const vector<double>& query, double c, int k) const {
+        Lectura v(*this);
+        Resultado res;
+        if(v->base && kBase(*v, k) > 0) res = v->base->C_ANN_K(query, c, kBase(*v, k));
+        mezclarDelta(*v, query, k, res);
+        return res;
+    }
+
+    // limites acota solo la búsqueda en el base; el delta se recorre completo
+    vector<Resultado> C_ANN_K_lote(const vector<vector<double>>& queries, double c, int k, ThreadPool& pool,
+                                   const LimitesConsulta& limites = {},
+                                   vector<EstadisticasConsulta>* estadisticas = nullptr) const {
+        Lectura v(*this);
+        vector<Resultado> res(queries.size());
+        if(estadisticas) estadisticas->assign(queries.size(), EstadisticasConsulta());
+        if(v->base && kBase(*v, k) > 0) res = v->base->C_ANN_K_lote(queries, c, kBase(*v, k), pool, limites, estadisticas);
+        if(v->n_delta > 0) pool.paraCada(queries.size(), [&](size_t b) { mezclarDelta(*v, queries[b], k, res[b]); });
+        return res;
+    }
+
+    size_t size() const {
+        Lectura v(*this);
+        return v->n_base + v->n_delta;
+    }
+
+    size_t pendientes() const {
+        Lectura v(*this);
+        return v->n_delta;
+    }
+
+    uint64_t version() const {
+        Lectura v(*this);
+        return v->numero;
+    }
+};
+
+#endif // VERSIONED_INDEX_H